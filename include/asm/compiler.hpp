@@ -16,8 +16,17 @@
 #define ASM_COMPILER_HPP
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
 
-std::vector<uint8_t> compile(const char* source);
+// source is lexed in place and never copied
+std::vector<uint8_t> compile(std::string_view source);
+
+// assembles source directly into output, which has room for capacity bytes; on success size
+// receives the number of bytes written. fails without writing anything if the program doesn't
+// fit
+bool compile_into(std::string_view source, uint8_t* output, std::size_t capacity,
+  std::size_t& size);
 
 #endif
\ No newline at end of file
@@ -32,6 +32,20 @@ struct syntax_error : std::runtime_error {
   int line, pos;
   std::string context;
   std::string help;
+  // set by the module build (see asm/module.hpp) to the file the error is in
+  std::string file;
+};
+
+// raised when objects can't be linked together (see asm/linker.hpp)
+struct link_error : std::runtime_error {
+  link_error(const char* msg, std::string symbol, std::string file, int line = 0, int pos = 0)
+      : std::runtime_error(msg), symbol{std::move(symbol)}, file{std::move(file)}, line{line},
+        pos{pos} {}
+
+  std::string symbol;
+  // module the error was found in, and where in it if known (line is 0 otherwise)
+  std::string file;
+  int line, pos;
 };
 
 #endif
@@ -0,0 +1,94 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ASM_INCREMENTAL_HPP
+#define ASM_INCREMENTAL_HPP
+
+#include "asm/parser.hpp"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// bytes of an assembled program, relative to its first byte
+struct byte_range {
+  std::size_t offset;
+  std::size_t size;
+};
+
+// assembles a source and keeps its statements, so that an edited copy of the source can be
+// reassembled by re-parsing only the statements around the edit
+class incremental_assembler {
+public:
+  // address of the first byte of the program
+  static constexpr std::size_t BASE_ADDRESS = 0x200;
+
+  // assembles source from scratch; throws syntax_error
+  void assemble(std::string source);
+
+  // reassembles source, an edited version of the last source, and returns the ranges of
+  // bytes() that changed, sorted by offset. parts of a range past the end of bytes() belonged
+  // to the previous program. throws syntax_error, in which case bytes() still holds the last
+  // program that assembled and the next update() starts from scratch
+  std::vector<byte_range> update(std::string source);
+
+  const std::vector<uint8_t>& bytes() const { return _bytes; }
+
+  // number of statements parsed by the last assemble() or update()
+  std::size_t parsed_statements() const { return _parsed; }
+
+private:
+  // a label, data block or instruction
+  struct statement {
+    // offset of the first token in _source
+    std::size_t begin = 0;
+    // name of the label, if this is one; interned so it outlives _source
+    std::string_view label;
+    // everything else; for labels only address is used
+    ir_instruction instr;
+
+    std::size_t size() const { return label.empty() ? instr.size() : 0; }
+  };
+
+  // fills this from scratch; on error, this is left partially filled
+  void build(std::string source);
+  std::vector<byte_range> rebuild(std::string source);
+  // parses _source[begin, end) as statements placed from address; address receives the end
+  std::vector<statement> parse_range(std::size_t begin, std::size_t end, std::size_t& address);
+  std::string_view intern(std::string_view name);
+  bool resolve(ir_instruction& instr) const;
+  // writes s to _bytes, recording a range in changes if that changed anything
+  void write_statement(const statement& s, std::vector<byte_range>& changes);
+  void compact_data();
+  [[noreturn]] void error(const char* msg, const statement& s, std::string_view context) const;
+
+  bool _valid = false;
+  std::string _source;
+  std::vector<statement> _statements;
+  // label name -> address
+  std::unordered_map<std::string_view, std::size_t> _labels;
+  // storage for label names; a deque so that views into it stay valid as it grows
+  std::deque<std::string> _names;
+  std::unordered_set<std::string_view> _name_index;
+  // payloads of data statements; replaced ones linger until compact_data
+  std::vector<uint8_t> _data;
+  std::size_t _live_data = 0;
+  std::vector<uint8_t> _bytes;
+  std::size_t _parsed = 0;
+};
+
+#endif
@@ -43,12 +43,15 @@ struct token {
   // view into original source string
   std::string_view span;
   int numeric_value = 0;
+  // token_type::mnemonic: id for opmetatable lookups, see opmetatable::mnemonic_id
+  int mnemonic = -1;
   source_location location;
 };
 
 class lexer {
 public:
-  lexer(std::string source);
+  // the lexer doesn't copy source; it must outlive the lexer and every token read from it
+  lexer(std::string_view source);
 
   void next();
 
@@ -61,30 +64,32 @@ public:
   }
 
   int line() const { return _line; }
-  int pos() const { return _pos; }
+  // columns aren't tracked while scanning, only derived from the start of the line
+  int pos() const { return static_cast<int>(_ptr - _line_start) + 1; }
 
 private:
-  // reads the next character from the string
-  char read_one();
+  // '\0' past the end
+  char peek(std::size_t offset = 0) const {
+    return offset < static_cast<std::size_t>(_end - _ptr) ? _ptr[offset] : '\0';
+  }
   token lex_one();
   void new_line();
   token read_number();
   token read_name();
   void read_comment();
+  token read_punctuation(token_type type);
   void error(const char* msg);
 
   token make_token(token_type type);
 
-  std::string _source;
-  char* _ptr;
+  const char* _ptr;
+  const char* _end;
+  const char* _line_start;
 
   int _line;
-  int _pos;
 
   token _cur;
   token _lookahead;
-
-  opmetatable _omtbl;
 };
 
 #endif
\ No newline at end of file
@@ -12,30 +12,24 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#ifndef FRONTEND_FREQUENCY_HPP
-#define FRONTEND_FREQUENCY_HPP
-
-#include <chrono>
-
-class frequency {
-public:
-  using duration = std::chrono::duration<double, std::milli>;
-
-  constexpr explicit frequency(int hz) : _d{0}, _hz{hz} { update_duration(); }
-
-  constexpr int hz() const { return _hz; }
-  constexpr void hz(int val) {
-    _hz = val;
-    update_duration();
-  }
-
-  constexpr duration dur() const { return _d; }
-
-private:
-  constexpr void update_duration() { _d = duration{1000 / (double)_hz}; }
-
-  duration _d;
-  int _hz;
+#ifndef ASM_LINKER_HPP
+#define ASM_LINKER_HPP
+
+#include "asm/object.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct link_input {
+  // used in link_error
+  std::string name;
+  const object_file* object;
 };
 
+// lays the objects out back to back starting at address, in the order given, and fills in
+// every relocation. labels are shared between all objects, so a label may only be defined
+// once. throws link_error
+std::vector<uint8_t> link(const std::vector<link_input>& inputs, std::size_t address = 0x200);
+
 #endif
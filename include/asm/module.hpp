@@ -0,0 +1,56 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ASM_MODULE_HPP
+#define ASM_MODULE_HPP
+
+#include "asm/optimizer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct module_options {
+  // directory to keep assembled objects in, named by a hash of their source, so that modules
+  // which haven't changed since the last build aren't assembled again. empty disables caching
+  std::string cache_dir;
+  // number of modules assembled at once; 0 uses one per hardware thread
+  unsigned threads = 0;
+  // run the peephole optimizer over every module
+  bool optimize = false;
+  // contents of the root module, if the caller has already read it; null reads root_path
+  const std::string* root_source = nullptr;
+};
+
+struct module_stats {
+  std::size_t assembled = 0;
+  // modules whose object was found in the cache
+  std::size_t cached = 0;
+  // totals over every module when optimizing
+  optimizer_stats optimized;
+};
+
+// assembles the file at root_path and every module it includes, directly or through another
+// module, then links them into a program starting at address. `include name` refers to
+// name.c8s in the directory of the including file; a module is only linked once no matter
+// how many times it's included. the root module comes first, followed by the others in the
+// order they were first included. throws syntax_error, with file set, and link_error
+std::vector<uint8_t> assemble_modules(const std::string& root_path,
+  const module_options& options = {}, module_stats* stats = nullptr, std::size_t address = 0x200);
+
+// true if source has an include statement, meaning it must be built with assemble_modules
+bool has_includes(std::string_view source);
+
+#endif
@@ -0,0 +1,67 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ASM_OBJECT_HPP
+#define ASM_OBJECT_HPP
+
+#include "asm/optimizer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a label defined by a module, relative to the start of its code
+struct object_symbol {
+  std::string name;
+  uint32_t offset;
+};
+
+// an instruction at `offset` whose address operand refers to `symbol`; the linker fills in
+// the address once it knows where the symbol ends up
+struct object_relocation {
+  uint32_t offset;
+  std::string symbol;
+  // location of the reference, for undefined label errors
+  int line, pos;
+};
+
+struct object_include {
+  std::string name;
+  int line, pos;
+};
+
+// one assembled module; its code is assembled as if it started at address 0
+struct object_file {
+  std::vector<uint8_t> code;
+  std::vector<object_symbol> symbols;
+  std::vector<object_relocation> relocations;
+  // modules named by include statements, in source order
+  std::vector<object_include> includes;
+  // what the optimizer did, if it ran
+  optimizer_stats optimized;
+};
+
+// assembles source into an object, optionally running the peephole optimizer over it; throws
+// syntax_error
+object_file assemble_object(std::string_view source, bool optimize = false);
+
+// binary encoding of an object, for caching them on disk. source_hash is stored alongside so a
+// cached object can be matched to the source it came from
+void write_object(std::vector<uint8_t>& output, const object_file& object, uint64_t source_hash);
+// returns false if data isn't a complete object of the current format or wasn't assembled from
+// a source hashing to source_hash
+bool read_object(const uint8_t* data, std::size_t size, uint64_t source_hash, object_file& object);
+
+#endif
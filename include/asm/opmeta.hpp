@@ -15,9 +15,9 @@
 #ifndef ASM_OPMETA_HPP
 #define ASM_OPMETA_HPP
 
+#include <array>
 #include <cstdint>
 #include <string_view>
-#include <vector>
 #include <string>
 #include <tuple>
 #include <cassert>
@@ -59,7 +59,7 @@ struct opmeta {
   uint8_t bshift = 0;
   uint8_t cshift = 0;
 
-  int parameter_count() const {
+  constexpr int parameter_count() const {
     int i = 0;
     if (a != operand_type::none) ++i;
     if (b != operand_type::none) ++i;
@@ -67,7 +67,7 @@ struct opmeta {
     return i;
   }
 
-  operand_type parameter(int operand_num) const {
+  constexpr operand_type parameter(int operand_num) const {
     assert(operand_num >= 0 && operand_num < 3);
     switch (operand_num) {
     case 0:
@@ -82,11 +82,11 @@ struct opmeta {
   }
 };
 
-inline bool operator<(const opmeta& x, const opmeta& y) {
+inline constexpr bool operator<(const opmeta& x, const opmeta& y) {
   return std::tie(x.mnemonic, x.a, x.b, x.c) < std::tie(y.mnemonic, y.a, y.b, y.c);
 }
 
-inline bool operator==(const opmeta& x, const opmeta& y) {
+inline constexpr bool operator==(const opmeta& x, const opmeta& y) {
   return std::tie(x.mnemonic, x.a, x.b, x.c) == std::tie(y.mnemonic, y.a, y.b, y.c);
 }
 
@@ -98,20 +98,154 @@ inline uint16_t generate_op(opmeta m, int a, int b, int c) {
   return instr;
 }
 
+// contiguous run of table entries
+struct opmeta_range {
+  const opmeta* first = nullptr;
+  const opmeta* last = nullptr;
+
+  constexpr const opmeta* begin() const { return first; }
+  constexpr const opmeta* end() const { return last; }
+  constexpr bool empty() const { return first == last; }
+};
+
+// every instruction the assembler and disassembler know about, built at compile time. use the
+// shared instance `opmetas` below rather than constructing another one
 class opmetatable {
 public:
-  opmetatable();
+  static constexpr std::size_t SIZE = 37;
+
+  constexpr opmetatable();
+
+  constexpr const opmeta* find_signature(const opmeta& sig) const {
+    return find_signature(mnemonic_id(sig.mnemonic), sig.a, sig.b, sig.c);
+  }
+
+  constexpr const opmeta* find_signature(
+    int mnemonic, operand_type a, operand_type b, operand_type c) const {
+    for (const opmeta& m : get_signatures(mnemonic)) {
+      if (m.a == a && m.b == b && m.c == c)
+        return &m;
+    }
+    return nullptr;
+  }
 
-  const opmeta* find_signature(const opmeta& sig) const;
+  // single load from an index of all 64K opcodes (see opmeta.cpp)
   const opmeta* find_opcode(uint16_t opcode) const;
-  bool is_mnemonic(std::string_view str) const;
 
-  std::vector<const opmeta*> get_signatures(std::string_view mnemonic) const;
+  constexpr bool is_mnemonic(std::string_view str) const { return mnemonic_id(str) >= 0; }
+
+  // distinct mnemonics are numbered 0 to mnemonic_count() - 1 in sort order
+  constexpr std::size_t mnemonic_count() const { return _mnemonic_count; }
+
+  constexpr std::string_view mnemonic_name(int id) const {
+    return _meta[_mnemonic_start[id]].mnemonic;
+  }
+
+  // returns -1 if str isn't a mnemonic
+  constexpr int mnemonic_id(std::string_view str) const {
+    // binary search over the first entry of each mnemonic
+    std::size_t lo = 0;
+    std::size_t hi = _mnemonic_count;
+    while (lo < hi) {
+      const std::size_t mid = (lo + hi) / 2;
+      if (_meta[_mnemonic_start[mid]].mnemonic < str)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == _mnemonic_count || _meta[_mnemonic_start[lo]].mnemonic != str)
+      return -1;
+    return static_cast<int>(lo);
+  }
+
+  // entries sharing a mnemonic, in sort order
+  constexpr opmeta_range get_signatures(std::string_view mnemonic) const {
+    return get_signatures(mnemonic_id(mnemonic));
+  }
+
+  constexpr opmeta_range get_signatures(int mnemonic) const {
+    if (mnemonic < 0 || mnemonic >= static_cast<int>(_mnemonic_count))
+      return {};
+    return {&_meta[_mnemonic_start[mnemonic]], &_meta[_mnemonic_start[mnemonic + 1]]};
+  }
+
+  constexpr const opmeta* begin() const { return _meta.data(); }
+  constexpr const opmeta* end() const { return _meta.data() + SIZE; }
+  constexpr const opmeta& operator[](std::size_t n) const { return _meta[n]; }
 
 private:
-  std::vector<opmeta> _meta;
+  std::array<opmeta, SIZE> _meta;
+
+  // index of the first entry of each distinct mnemonic; _mnemonic_start[_mnemonic_count] is
+  // SIZE
+  std::array<uint8_t, SIZE + 1> _mnemonic_start{};
+  std::size_t _mnemonic_count = 0;
 };
 
+constexpr opmetatable::opmetatable()
+  // clang-format off
+  : _meta{{
+    // Core instructions
+    {"cls",   operand_type::none, operand_type::none, operand_type::none, 0x00E0, 0, 0, 0},
+    {"ret",   operand_type::none, operand_type::none, operand_type::none, 0x00EE, 0, 0, 0},
+    {"jmp",   operand_type::addr, operand_type::none, operand_type::none, 0x1000, 0, 0, 0},
+    {"call",  operand_type::addr, operand_type::none, operand_type::none, 0x2000, 0, 0, 0},
+    {"skeq",  operand_type::v,    operand_type::k,    operand_type::none, 0x3000, 8, 0, 0},
+    {"skne",  operand_type::v,    operand_type::k,    operand_type::none, 0x4000, 8, 0, 0},
+    {"skeq",  operand_type::v,    operand_type::v,    operand_type::none, 0x5000, 8, 4, 0},
+    {"ld",    operand_type::v,    operand_type::k,    operand_type::none, 0x6000, 8, 0, 0},
+    {"add",   operand_type::v,    operand_type::k,    operand_type::none, 0x7000, 8, 0, 0},
+    {"ld",    operand_type::v,    operand_type::v,    operand_type::none, 0x8000, 8, 4, 0},
+    {"or",    operand_type::v,    operand_type::v,    operand_type::none, 0x8001, 8, 4, 0},
+    {"and",   operand_type::v,    operand_type::v,    operand_type::none, 0x8002, 8, 4, 0},
+    {"xor",   operand_type::v,    operand_type::v,    operand_type::none, 0x8003, 8, 4, 0},
+    {"add",   operand_type::v,    operand_type::v,    operand_type::none, 0x8004, 8, 4, 0},
+    {"sub",   operand_type::v,    operand_type::v,    operand_type::none, 0x8005, 8, 4, 0},
+    {"shr",   operand_type::v,    operand_type::v,    operand_type::none, 0x8006, 8, 4, 0},
+    {"subn",  operand_type::v,    operand_type::v,    operand_type::none, 0x8007, 8, 4, 0},
+    {"shl",   operand_type::v,    operand_type::v,    operand_type::none, 0x800E, 8, 4, 0},
+    {"skne",  operand_type::v,    operand_type::v,    operand_type::none, 0x9000, 8, 4, 0},
+    {"ld",    operand_type::i,    operand_type::addr, operand_type::none, 0xA000, 0, 0, 0},
+    {"ld",    operand_type::i,    operand_type::k,    operand_type::none, 0xA000, 0, 0, 0},
+    {"jmp0",  operand_type::addr, operand_type::none, operand_type::none, 0xB000, 0, 0, 0},
+    {"rand",  operand_type::v,    operand_type::k,    operand_type::none, 0xC000, 8, 0, 0},
+    {"disp",  operand_type::v,    operand_type::v,    operand_type::k,    0xD000, 8, 4, 0},
+    {"skp",   operand_type::v,    operand_type::none, operand_type::none, 0xE09E, 8, 0, 0},
+    {"sknp",  operand_type::v,    operand_type::none, operand_type::none, 0xE0A1, 8, 0, 0},
+    {"ld",    operand_type::v,    operand_type::dt,   operand_type::none, 0xF007, 8, 0, 0},
+    {"input", operand_type::v,    operand_type::none, operand_type::none, 0xF00A, 8, 0, 0},
+    {"ld",    operand_type::dt,   operand_type::v,    operand_type::none, 0xF015, 0, 8, 0},
+    {"ld",    operand_type::st,   operand_type::v,    operand_type::none, 0xF018, 0, 8, 0},
+    {"add",   operand_type::i,    operand_type::v,    operand_type::none, 0xF01E, 0, 8, 0},
+    {"glyph", operand_type::v,    operand_type::none, operand_type::none, 0xF029, 8, 0, 0},
+    {"bcd",   operand_type::v,    operand_type::none, operand_type::none, 0xF033, 8, 0, 0},
+    {"store", operand_type::v,    operand_type::none, operand_type::none, 0xF055, 8, 0, 0},
+    {"load",  operand_type::v,    operand_type::none, operand_type::none, 0xF065, 8, 0, 0},
+
+    // superchip instructions
+    {"lores", operand_type::none, operand_type::none, operand_type::none, 0x00FE, 0, 0, 0},
+    {"hires", operand_type::none, operand_type::none, operand_type::none, 0x00FF, 0, 0, 0},
+  }} {
+  // clang-format on
+
+  // needs to be sorted for search algorithms; std::sort isn't constexpr until c++20
+  for (std::size_t i = 1; i < SIZE; ++i) {
+    for (std::size_t j = i; j > 0 && _meta[j] < _meta[j - 1]; --j) {
+      const opmeta tmp = _meta[j];
+      _meta[j] = _meta[j - 1];
+      _meta[j - 1] = tmp;
+    }
+  }
+
+  for (std::size_t i = 0; i < SIZE; ++i) {
+    if (i == 0 || _meta[i].mnemonic != _meta[i - 1].mnemonic)
+      _mnemonic_start[_mnemonic_count++] = static_cast<uint8_t>(i);
+  }
+  _mnemonic_start[_mnemonic_count] = static_cast<uint8_t>(SIZE);
+}
+
+inline constexpr opmetatable opmetas;
+
 bool has_param(const opmeta& m, int operand_num);
 std::string param_string(const opmeta& m, uint16_t opcode, int operand_num);
 
@@ -0,0 +1,54 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ASM_OPTIMIZER_HPP
+#define ASM_OPTIMIZER_HPP
+
+#include "asm/parser.hpp"
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// counts of what the optimizer changed
+struct optimizer_stats {
+  // instructions in the program, not counting data
+  std::size_t instructions_before = 0;
+  std::size_t instructions_after = 0;
+  // jmp or call to a jmp, retargeted to where that jmp goes
+  std::size_t jumps_threaded = 0;
+  // call followed by ret, turned into jmp
+  std::size_t tail_calls = 0;
+  // instructions after an unconditional jmp, jmp0 or ret that nothing can reach
+  std::size_t dead_removed = 0;
+  // ld of a value the variable is already known to hold
+  std::size_t loads_removed = 0;
+
+  std::size_t removed() const { return instructions_before - instructions_after; }
+
+  optimizer_stats& operator+=(const optimizer_stats& other);
+};
+
+// peephole optimizer over parsed but unresolved instructions (see parser::optimize). labels and
+// fixups are updated to match the rewritten program.
+//
+// only labels mark places control can enter, so code is assumed not to be modified or jumped
+// into at runtime except through them. the block following a label used by jmp0 or ld i is
+// taken to be a jump table or data and is left alone. if a jmp, call, jmp0 or ld i is given a
+// numeric address instead of a label, nothing is removed, since whatever it points to has to
+// stay put
+optimizer_stats optimize(ir_program& program,
+  std::unordered_map<std::string_view, std::size_t>& labels, std::vector<label_fixup>& fixups);
+
+#endif
@@ -19,10 +19,12 @@
 #include "asm/error.hpp"
 #include <cstdint>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 struct token;
 class lexer;
+struct optimizer_stats;
 
 // intermediate representation of a chip-8 instruction
 struct ir_instruction {
@@ -30,65 +32,112 @@ struct ir_instruction {
   const opmeta* m = nullptr;
 
   // operands to substitute into the opmeta template
-  int a, b, c;
+  int a = 0, b = 0, c = 0;
 
   // if one of the opmeta parameters is addr, label_ref is the name of the label
   std::string_view label_ref;
 
-  // only used for data metainstruction
-  std::vector<uint8_t> parameters;
+  // only used for data metainstruction; the bytes live in ir_program::data
+  uint32_t data_offset = 0;
+  uint32_t data_size = 0;
 
   // used by labels to fixup references
-  std::size_t address;
+  std::size_t address = 0;
 
   std::size_t size() const {
     if (is_data()) {
-      return parameters.size();
+      return data_size;
     } else {
       return 2;
     }
   }
 
-  bool is_data() const { return parameters.size(); }
+  bool is_data() const { return data_size; }
 };
 
-struct label {
+// `include name` names another module of the program (see asm/module.hpp)
+struct module_include {
   std::string_view name;
+  int line, pos;
+};
+
+struct ir_program {
+  std::vector<ir_instruction> instructions;
+  // payloads of every data metainstruction, back to back
+  std::vector<uint8_t> data;
+  std::vector<module_include> includes;
+
+  const uint8_t* payload(const ir_instruction& instr) const {
+    return data.data() + instr.data_offset;
+  }
+
+  // total number of bytes the program assembles to
+  std::size_t size() const {
+    return instructions.empty() ? 0 : instructions.back().address + instructions.back().size() -
+                                        instructions.front().address;
+  }
+};
+
+// an instruction whose addr operand names a label; patched once all labels are known
+struct label_fixup {
   std::size_t instr_index;
+  // location of the label reference, for undefined label errors
+  int line, pos;
 };
 
+// what a call to parser::parse_statement consumed
+enum class statement_type { label, data, instruction, include };
+
 class parser {
 public:
-  parser(lexer& lex);
-
-  std::vector<ir_instruction> parse_instructions();
+  // address is where the first instruction will be placed
+  parser(lexer& lex, std::size_t address = 0x200);
+
+  ir_program parse_program();
+
+  // lower level interface for callers that keep track of statements themselves (see
+  // asm/incremental.hpp). parse_statement parses the next label, data block, instruction or
+  // include into program() and leaves labels unresolved
+  bool at_end();
+  statement_type parse_statement();
+  const ir_program& program() const { return _program; }
+  // label name -> address, and the instructions referring to a label, so far
+  const std::unordered_map<std::string_view, std::size_t>& labels() const { return _labels; }
+  const std::vector<label_fixup>& fixups() const { return _fixups; }
+  // runs the peephole optimizer (see asm/optimizer.hpp) over everything parsed so far. only
+  // valid once at_end(), and before parse_program() resolves labels
+  optimizer_stats optimize();
+  // address of the next instruction
+  std::size_t address() const { return _address; }
 
 private:
   const token& current();
   const token& next();
   void add_instruction(ir_instruction i);
-  void parse_top_level();
   void parse_label();
   void parse_data();
+  void parse_include();
   void parse_instruction();
   void resolve_labels();
-  void error(const char* msg, const token& t);
-  void error(const char* msg, const token& t, std::string help);
+  [[noreturn]] void error(const char* msg, const token& t);
+  [[noreturn]] void error(const char* msg, const token& t, std::string help);
 
-  std::vector<ir_instruction> _instructions;
-  std::vector<label> _labels;
+  ir_program _program;
+  // label name -> address of the instruction following it
+  std::unordered_map<std::string_view, std::size_t> _labels;
+  std::vector<label_fixup> _fixups;
 
   lexer& _lex;
 
   std::size_t _address = 0x200;
-
-  opmetatable _omtbl;
 };
 
 #include <iosfwd>
 
 uint16_t encode_instruction(const ir_instruction& instr);
-void write_instruction(std::ostream& output, const ir_instruction& instr);
-void write_instruction(std::vector<uint8_t>& output, const ir_instruction& instr);
+// output must have room for program.size() bytes
+void write_program(uint8_t* output, const ir_program& program);
+void write_program(std::ostream& output, const ir_program& program);
+void write_program(std::vector<uint8_t>& output, const ir_program& program);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMMON_FNV1A_HPP
+#define COMMON_FNV1A_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+inline constexpr std::uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325;
+inline constexpr std::uint64_t FNV1A_PRIME = 0x100000001b3;
+
+// 64-bit FNV-1a; pass the result of a previous call as `h` to hash data in pieces
+inline constexpr std::uint64_t fnv1a(
+  const std::uint8_t* data, std::size_t size, std::uint64_t h = FNV1A_OFFSET_BASIS) {
+  for (std::size_t i = 0; i < size; ++i) {
+    h ^= data[i];
+    h *= FNV1A_PRIME;
+  }
+  return h;
+}
+
+inline constexpr std::uint64_t fnv1a(std::string_view str, std::uint64_t h = FNV1A_OFFSET_BASIS) {
+  for (char ch : str) {
+    h ^= static_cast<std::uint8_t>(ch);
+    h *= FNV1A_PRIME;
+  }
+  return h;
+}
+
+#endif
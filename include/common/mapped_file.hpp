@@ -0,0 +1,148 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMMON_MAPPED_FILE_HPP
+#define COMMON_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only view of a whole file, mapped into memory instead of copied; the contents are not
+// NUL terminated, so use size() or view() to find the end
+class mapped_file {
+public:
+  mapped_file() = default;
+
+  explicit mapped_file(const char* filename) { open(filename); }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept { swap(other); }
+
+  mapped_file& operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+      close();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~mapped_file() { close(); }
+
+  bool is_open() const { return _open; }
+  const char* data() const { return _data; }
+  std::size_t size() const { return _size; }
+  std::string_view view() const { return {_data, _size}; }
+
+private:
+#ifdef _WIN32
+  void open(const char* filename) {
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      return;
+    }
+    _size = static_cast<std::size_t>(size.QuadPart);
+    _open = true;
+    // empty files can't be mapped, but are valid input
+    if (_size) {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping) {
+        _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+      }
+      if (!_data) {
+        _size = 0;
+        _open = false;
+      }
+    }
+    CloseHandle(file);
+  }
+
+  void close() {
+    if (_size)
+      UnmapViewOfFile(_data);
+    _data = "";
+    _size = 0;
+    _open = false;
+  }
+#else
+  void open(const char* filename) {
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return;
+    }
+    _size = static_cast<std::size_t>(st.st_size);
+    _open = true;
+    // empty files can't be mapped, but are valid input
+    if (_size) {
+      void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        _size = 0;
+        _open = false;
+      } else {
+        // sources are lexed front to back exactly once
+        madvise(p, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(p);
+      }
+    }
+    ::close(fd);
+  }
+
+  void close() {
+    if (_size)
+      munmap(const_cast<char*>(_data), _size);
+    _data = "";
+    _size = 0;
+    _open = false;
+  }
+#endif
+
+  void swap(mapped_file& other) noexcept {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_open, other._open);
+  }
+
+  const char* _data = "";
+  std::size_t _size = 0;
+  bool _open = false;
+};
+
+#endif
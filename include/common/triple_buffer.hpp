@@ -0,0 +1,61 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMMON_TRIPLE_BUFFER_HPP
+#define COMMON_TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// lock-free handoff of the newest value from one writer thread to one reader thread
+//
+// the writer fills back() and publishes it; the reader picks up whatever was published last,
+// skipping values it was too slow to see. neither side ever waits for the other
+template <typename T>
+class triple_buffer {
+public:
+  // writer only; note that this holds a stale value that must be overwritten
+  T& back() { return _slots[_back]; }
+
+  // writer only; makes back() available to the reader
+  void publish() {
+    _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // reader only; if something was published since the last call, makes it the front and
+  // returns true
+  bool update() {
+    if (!(_middle.load(std::memory_order_relaxed) & FRESH)) {
+      return false;
+    }
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  // reader only
+  const T& front() const { return _slots[_front]; }
+
+private:
+  // _middle holds a slot index, plus FRESH if the reader hasn't taken it yet
+  static constexpr uint8_t INDEX = 0b011;
+  static constexpr uint8_t FRESH = 0b100;
+
+  std::array<T, 3> _slots{};
+  uint8_t _back = 0;
+  std::atomic<uint8_t> _middle{1};
+  uint8_t _front = 2;
+};
+
+#endif
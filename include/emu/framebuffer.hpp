@@ -18,8 +18,18 @@
 #include <vector>
 #include <cstdint>
 
+// monochrome pixels packed 8 to a byte, leftmost pixel in the most significant bit; every row
+// starts on a new byte
 class framebuffer {
 public:
+  // rows [first, last)
+  struct row_span {
+    std::size_t first;
+    std::size_t last;
+
+    bool empty() const { return first == last; }
+  };
+
   framebuffer();
   framebuffer(std::size_t width, std::size_t height);
 
@@ -27,16 +37,38 @@ public:
   bool toggle(int x, int y);
   bool is_on(int x, int y) const;
 
+  // reallocates storage for the new dimensions and clears it; unlike assigning a new
+  // framebuffer, this keeps the generation counting up
+  void resize(std::size_t width, std::size_t height);
+
   std::size_t width() const { return _width; }
   std::size_t height() const { return _height; }
+  // bytes per row
+  std::size_t stride() const { return _stride; }
   const uint8_t* data() const { return _pixels.data(); }
 
+  // increases every time pixels change, so comparing it against a remembered value tells
+  // whether anything needs to be redrawn
+  uint64_t generation() const { return _generation; }
+
+  // smallest span of rows that contains every change made after `generation`
+  row_span changed_since(uint64_t generation) const;
+
+  // marks every row as changed; the new generation is greater than both the current one and
+  // `after`
+  void touch_all(uint64_t after = 0);
+
 private:
   void wrap(int& x, int& y) const;
 
   std::size_t _width;
   std::size_t _height;
+  std::size_t _stride;
   std::vector<uint8_t> _pixels;
+
+  uint64_t _generation = 0;
+  // generation of the last change to each row
+  std::vector<uint64_t> _row_generation;
 };
 
 #endif
\ No newline at end of file
@@ -42,6 +42,13 @@ inline constexpr bool is_valid_key(chip8_key k) {
   return k >= 0 && k < HEXKEY_COUNT;
 }
 
+// a key change scheduled for the instruction at `cycle` within a frame
+struct input_event {
+  int cycle;
+  chip8_key key;
+  bool pressed;
+};
+
 struct input_state {
   static const chip8_key LAST_KEY_NONE = (chip8_key)-1;
 
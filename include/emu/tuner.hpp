@@ -0,0 +1,59 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EMU_TUNER_HPP
+#define EMU_TUNER_HPP
+
+#include <optional>
+
+class chip8vm;
+
+// Watches a rom's frame loop to find out how many instructions per frame it actually needs.
+//
+// Most roms do their work for a frame and then idle until the next one: they poll dt until it
+// reaches zero, spin on a jump to themselves, or block on input. Instructions executed after
+// that point don't change what ends up on screen, so the busiest observed frame (plus some
+// headroom) is the lowest speed that reproduces the same frames.
+class cycle_tuner {
+public:
+  explicit cycle_tuner(int frames_to_observe = 180);
+
+  // call before each chip8vm::step()
+  void observe(const chip8vm& vm);
+  // call once per 60hz timer tick. pass true if the frame ended early on a sprite draw with
+  // compat_flags::display_wait; the draw is then the frame's idle point
+  void end_frame(bool display_wait = false);
+
+  bool finished() const { return _frames >= _frames_to_observe; }
+
+  // lowest number of cycles per frame that lets every observed frame reach its idle point;
+  // empty if the rom ever used its whole budget, since running it slower would change its
+  // behavior
+  std::optional<int> recommendation() const;
+
+private:
+  int _frames_to_observe;
+  int _frames = 0;
+  int _max_busy = 0;
+  bool _saturated = false;
+
+  // per-frame state
+  int _cycle = 0;
+  int _busy = 0;
+  bool _idle = false;
+  int _last_pc = -1;
+  int _dt_poll_pc = -1;
+};
+
+#endif
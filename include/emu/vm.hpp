@@ -63,13 +63,23 @@ inline constexpr const char* cpu_status_str(cpu_status s) {
 
 enum class compat_flags {
   none = 0,
-  shift_in_place = 1
+  shift_in_place = 1,
+  // drawing a sprite ends the current frame, like the cosmac vip waiting for vertical blank
+  display_wait = 2
 };
 
 inline constexpr bool operator&(const compat_flags& x, const compat_flags& y) {
   return static_cast<int>(x) & static_cast<int>(y);
 }
 
+inline constexpr compat_flags operator|(const compat_flags& x, const compat_flags& y) {
+  return static_cast<compat_flags>(static_cast<int>(x) | static_cast<int>(y));
+}
+
+inline constexpr compat_flags& operator|=(compat_flags& x, const compat_flags& y) {
+  return x = x | y;
+}
+
 class chip8vm {
 public:
   // XO sized roms fit in 64k of ram, however we add some additional padding to
@@ -124,6 +134,49 @@ public:
 
   void step();
 
+  // executes up to `cycles` instructions and returns the number executed; stops early if the
+  // cpu faults, or after drawing a sprite if compat_flags::display_wait is set
+  int run(int cycles) {
+    return run(cycles, [](const chip8vm&) {});
+  }
+
+  // same as above, but calls before_step(*this) ahead of every instruction
+  template <typename Observer>
+  int run(int cycles, Observer&& before_step) {
+    int executed = 0;
+    vblank_wait = false;
+    while (executed < cycles && status == cpu_status::ok && !vblank_wait) {
+      before_step(static_cast<const chip8vm&>(*this));
+      step();
+      ++executed;
+    }
+    return executed;
+  }
+
+  // same as above, but also applies the events in [first, last) to inp just before the
+  // instruction at their cycle; events must be sorted by cycle. events at or past the point
+  // where the frame ended are applied after it
+  template <typename Observer>
+  int run(int cycles, const input_event* first, const input_event* last, Observer&& before_step) {
+    if (first == last)
+      return run(cycles, before_step);
+
+    int cycle = 0;
+    const int executed = run(cycles, [&](const chip8vm& vm) {
+      for (; first != last && first->cycle <= cycle; ++first)
+        inp.set_key_state(first->key, first->pressed);
+      ++cycle;
+      before_step(vm);
+    });
+    for (; first != last; ++first)
+      inp.set_key_state(first->key, first->pressed);
+    return executed;
+  }
+
+  // true if the last run() ended early because a sprite was drawn with
+  // compat_flags::display_wait
+  bool waiting_for_vblank() const { return vblank_wait; }
+
 private:
   // carry flag, borrow flag, collision flag
   void vf(bool value) { variables[0xF] = value; }
@@ -219,10 +272,13 @@ private:
   };
 
 private:
-  std::random_device rd;
+  // copies of a vm continue the same random sequence, so a copy run with the same input
+  // produces the same frames
   std::mt19937 rng;
   std::uniform_int_distribution<> byte_dist;
   chip8_step_context step_context;
+  // set when a sprite is drawn with compat_flags::display_wait; ends run()
+  bool vblank_wait = false;
 };
 
 #endif
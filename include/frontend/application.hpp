@@ -15,17 +15,21 @@
 #ifndef FRONTEND_APPLICATION_HPP
 #define FRONTEND_APPLICATION_HPP
 
-#include "emu/vm.hpp"
 #include "frontend/audio.hpp"
-#include "frontend/debugger.hpp"
-#include "frontend/frequency.hpp"
+#include "frontend/emulator.hpp"
+#include "frontend/pacer.hpp"
 #include "frontend/config.hpp"
+#include "frontend/romdb.hpp"
+#include "frontend/file_watcher.hpp"
+#include "frontend/worker.hpp"
 #include <SDL.h>
 #include <memory>
 #include <optional>
 #include <map>
 
 class renderer;
+struct debugger;
+class incremental_assembler;
 
 class application {
 public:
@@ -35,7 +39,8 @@ public:
   void run();
 
 private:
-  void handle_events();
+  void handle_events(int timeout_ms);
+  void handle_event(const SDL_Event& ev);
   void handle_drop_file(const SDL_DropEvent& ev);
   void handle_key_up(const SDL_KeyboardEvent& ev);
   void handle_key_down(const SDL_KeyboardEvent& ev);
@@ -44,23 +49,52 @@ private:
 
   void handle_command_line(int argc, char* argv[]);
 
+  bool is_idle() const;
+  void toggle_pause();
+  void set_cycles_per_frame(int cpf);
+  void set_fast_forward(bool enabled);
   void render_frame();
-
-  bool load_file(const char* filename);
+  bool debugger_visible() const;
+  void set_debugger_visible(bool visible);
+
+  // what load_file's job produces for finish_load
+  struct loaded_file {
+    std::string path;
+    std::unique_ptr<chip8vm> vm;
+    // set if the file is a .c8s without includes
+    std::unique_ptr<incremental_assembler> assembler;
+    std::size_t program_size = 0;
+    uint64_t hash = 0;
+    bool success = false;
+    std::string errmsg;
+  };
+
+  // reads or assembles the file on the worker; the result is loaded by finish_load
+  void load_file(const char* filename);
+  void finish_load(loaded_file result);
+  // patches the running program if it was assembled from source, otherwise loads it again
+  void reload_file();
+  void file_changed(const std::string& path);
+  void update_watched_files();
+  void apply_rom_profile(const rom_profile* profile, bool same_file);
+  void update_keymap(const rom_profile* profile);
+  const rom_profile* find_rom_profile(uint64_t hash);
+  void finish_tuning(const tuning_result& result);
   void update_title();
 
   void load_config();
+  // reads the config file again on the worker and applies what can change while running
+  void reload_config();
+  void apply_config(application_config next);
 
   void update_viewport();
   void toggle_fullscreen();
 
 private:
-  using clock = std::chrono::high_resolution_clock;
-  using duration = std::chrono::duration<double, std::milli>;
-  using time_point = typename clock::time_point;
-
-  std::unique_ptr<chip8vm> chip8;
   std::unique_ptr<audio_context> audio;
+  // owns the vm; declared after audio since it plays tones through it
+  std::unique_ptr<emulator> emu;
+  // created the first time it is shown
   std::unique_ptr<debugger> debug;
   SDL_Window* window = nullptr;
   SDL_GLContext gl = nullptr;
@@ -69,21 +103,54 @@ private:
 
   bool fullscreen = false;
 
+  // area of the window the emulator display is drawn to, starting at the left edge
+  int view_width = 0;
+  int view_height = 0;
+
   Uint32 window_id = 0;
 
   bool running = true;
 
-  // if true, do not advance cpu and timers
+  // if true, the emulation thread does not advance cpu and timers
   bool paused = false;
 
+  // true while the fast forward key is held
+  bool fast_forward = false;
+
   // empty if no file loaded yet
   std::optional<std::string> filename;
 
-  // timing
-  frequency cpu_freq{500000};
-  frequency timer_freq{60};
+  // set while the loaded file is a .c8s without includes; reloading it patches the running
+  // program. only used by jobs on the worker once the file is loaded
+  std::shared_ptr<incremental_assembler> assembler;
+
+  // incremented by every load_file; only the result of the latest one is loaded
+  unsigned load_serial = 0;
+
+  // timing; every frame runs cycles_per_frame instructions, then ticks the timers. this is
+  // the main thread's copy, forwarded to the emulation thread whenever it changes
+  static constexpr int DEFAULT_CYCLES_PER_FRAME = 8333;
+  int cycles_per_frame = DEFAULT_CYCLES_PER_FRAME;
+  frame_pacer pacer;
 
   application_config cfg;
+  std::string config_path;
+
+  // cfg.input.kmap with any overrides from the loaded rom's profile applied
+  keymap kmap;
+
+  std::unique_ptr<romdb> roms;
+
+  // hash of the loaded rom; only meaningful if filename is set
+  uint64_t rom_id = 0;
+
+  // result of tuning in recommend mode
+  std::optional<int> suggested_cycles_per_frame;
+
+  // reassembles and rereads files off the main thread
+  std::unique_ptr<worker> jobs;
+  // empty unless cfg.watch.enabled
+  std::unique_ptr<file_watcher> watcher;
 };
 
 #endif
@@ -19,7 +19,9 @@
 #include <map>
 #include <SDL_keycode.h>
 #include "emu/input.hpp"
+#include "emu/vm.hpp"
 #include "frontend/color.hpp"
+#include "frontend/pacer.hpp"
 #include "keymap.hpp"
 
 class config_error : public std::runtime_error {
@@ -41,22 +43,64 @@ struct input_config {
   SDL_Keycode toggle_debugger;
   SDL_Keycode increase_cycles;
   SDL_Keycode decrease_cycles;
+  SDL_Keycode fast_forward;
 };
 
 struct display_config {
   color4i render_foreground{0xac, 0xd5, 0xff};
   color4i render_background{0x11, 0x31, 0x52};
+  vsync_mode vsync = vsync_mode::on;
 };
 
 struct debug_config {
   bool visible = false;
 };
 
+enum class tuning_mode {
+  // run every rom at the configured speed
+  off,
+  // observe the rom and report the speed it needs
+  recommend,
+  // observe the rom and switch to the speed it needs
+  apply
+};
+
+struct cpu_config {
+  tuning_mode auto_tune = tuning_mode::off;
+  // store tuning results in the rom database
+  bool save_tuning = false;
+  // applied to every rom in addition to the quirks from its profile
+  compat_flags quirks = compat_flags::none;
+};
+
+struct latency_config {
+  // frames to emulate ahead of the real vm with the latest input before presenting
+  int run_ahead = 0;
+};
+
+struct fast_forward_config {
+  // how many times faster than normal to run; 0 runs as fast as the host allows
+  int speed = 0;
+  // only every Nth emulated frame is shown while fast forwarding
+  int present_every = 4;
+};
+
+struct watch_config {
+  // reload the loaded rom and this config file when they change on disk
+  bool enabled = true;
+  // wait for a file to stop changing for this long before reloading it
+  int debounce_ms = 100;
+};
+
 struct application_config {
   audio_config audio;
   input_config input;
   display_config display;
   debug_config debug;
+  cpu_config cpu;
+  latency_config latency;
+  fast_forward_config fast_forward;
+  watch_config watch;
 };
 
 application_config load_config(const std::string& path);
@@ -17,43 +17,40 @@
 
 #include <SDL.h>
 #include "asm/opmeta.hpp"
-#include "emu/vm.hpp"
+#include "frontend/emulator.hpp"
+#include "frontend/pacer.hpp"
 #include <functional>
 
 class application;
 
+// panel docked along the right edge of the main window, drawn with the window's gl context
 struct debugger {
 public:
-  debugger();
-  ~debugger();
+  static constexpr int PANEL_WIDTH = 300;
 
-  void process_event(const SDL_Event& ev);
-  void set_state(chip8vm* ptr);
+  debugger(SDL_Window* window, SDL_GLContext gl);
+  ~debugger();
 
-  void render(int cps);
+  // returns true if the panel wants the event for itself, e.g. a click on one of its buttons
+  bool process_event(const SDL_Event& ev);
 
-  bool is_visible() const;
-  void show();
-  void hide();
-  void toggle_visibility();
+  // draws the panel over the current back buffer; does not swap
+  void render(const frame_snapshot& frame, const frame_stats& frame_times);
 
-  void set_position(int x, int y);
+  bool is_visible() const { return _visible; }
+  void show() { _visible = true; }
+  void hide() { _visible = false; }
+  void toggle_visibility() { _visible = !_visible; }
 
   void notify_pause_state(bool paused) { _paused = paused; }
 
-  SDL_Window* window() const { return _window; }
-  Uint32 window_id() const { return _windowid; }
-
 public:
   std::function<void()> on_click_pause;
   std::function<void()> on_click_step;
 
 private:
   SDL_Window* _window;
-  SDL_GLContext _gl;
-  chip8vm* _chip8;
-  opmetatable _omtbl;
-  Uint32 _windowid;
+  bool _visible = false;
   bool _paused = false;
 };
 
@@ -0,0 +1,210 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_EMULATOR_HPP
+#define FRONTEND_EMULATOR_HPP
+
+#include "common/spsc_queue.hpp"
+#include "common/triple_buffer.hpp"
+#include "emu/tuner.hpp"
+#include "emu/vm.hpp"
+#include "frontend/config.hpp"
+#include "frontend/frame_clock.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class audio_context;
+
+// copy of the cpu state shown by the debugger
+struct cpu_snapshot {
+  // bytes of memory captured around pc for disassembly
+  static constexpr int CODE_BEFORE_PC = 16;
+  static constexpr int CODE_SIZE = 2 * CODE_BEFORE_PC + 2;
+
+  std::array<uint8_t, chip8vm::VARIABLE_COUNT> variables{};
+  cpu_status status = cpu_status::ok;
+  uint16_t pc = chip8vm::PROGRAM_START;
+  uint16_t i = 0;
+  uint8_t dt = 0;
+  uint8_t st = 0;
+  // memory starting at pc - CODE_BEFORE_PC; bytes outside of memory read as zero
+  std::array<uint8_t, CODE_SIZE> code{};
+
+  void capture(const chip8vm& vm);
+};
+
+// everything the main thread needs to present one emulated frame
+struct frame_snapshot {
+  framebuffer framebuf{64, 32};
+  cpu_snapshot cpu;
+  int cycles_per_second = 0;
+  // frames emulated ahead of the real vm to produce framebuf, and the average host time that
+  // took per presented frame
+  int run_ahead = 0;
+  float run_ahead_ms = 0;
+};
+
+// program bytes to write over the running vm, leaving the rest of its state alone
+struct memory_patch {
+  struct range {
+    // relative to chip8vm::PROGRAM_START
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  std::vector<range> ranges;
+  // contents of every range, back to back
+  std::vector<uint8_t> bytes;
+};
+
+// requests sent from the main thread to the emulation thread
+struct emu_command {
+  enum class type {
+    key_down,
+    key_up,
+    set_paused,
+    // value is 0 or 1
+    set_fast_forward,
+    step,
+    set_cycles_per_frame,
+    // replaces the running vm
+    load,
+    // writes a memory_patch into the running vm
+    patch
+  };
+
+  type kind;
+  // key_down/key_up: a chip8_key; set_cycles_per_frame: the new value; otherwise 0 or 1
+  int value = 0;
+  // key_down/key_up: host time the key changed; it is applied at the matching cycle
+  frame_clock::clock::time_point time{};
+  // load: the vm to run; the emulation thread takes it over
+  std::unique_ptr<chip8vm> vm;
+  // load: identifies the rom in tuning results
+  uint64_t rom_id = 0;
+  // load: observe the rom with cycle_tuner
+  bool tune = false;
+  // patch: the bytes to write
+  std::unique_ptr<memory_patch> patch;
+};
+
+// sent back to the main thread once cycle_tuner has seen enough of a rom
+struct tuning_result {
+  uint64_t rom_id = 0;
+  std::optional<int> cycles_per_frame;
+};
+
+// runs a chip8vm on its own thread so that rendering and event handling can't stall it
+//
+// the main thread talks to it only through lock-free queues: commands go in with post(), and
+// finished frames come out through update_frame()/frame()
+class emulator {
+public:
+  using clock = frame_clock::clock;
+  using duration = frame_clock::duration;
+  using time_point = clock::time_point;
+
+  emulator(audio_context& audio,
+    int cycles_per_frame,
+    const latency_config& latency,
+    const fast_forward_config& fast_forward);
+  ~emulator();
+
+  emulator(const emulator&) = delete;
+  emulator& operator=(const emulator&) = delete;
+
+  void start();
+  void stop();
+
+  // the remaining functions may only be called from the main thread
+
+  void post(emu_command cmd);
+  bool poll_tuning_result(tuning_result& result) { return _results.pop(result); }
+
+  // picks up the newest published frame; returns true if there was one
+  bool update_frame() { return _frames_out.update(); }
+  const frame_snapshot& frame() const { return _frames_out.front(); }
+
+  duration frame_period() const { return _frames.period(); }
+
+private:
+  void thread_main();
+  void process_commands();
+  void process_command(emu_command& cmd);
+  void queue_key(const emu_command& cmd);
+  // emulates the frame that covers host time [begin, begin + length)
+  void emulate_frame(time_point begin, duration length);
+  // emulates frames back to back for about one frame period
+  int emulate_uncapped(time_point now);
+  // publishes the newest of `frames` just emulated frames, if it should be shown
+  void present(int frames);
+  void run_ahead();
+  void update_profile(duration elapsed);
+  void publish(chip8vm& shown);
+
+  std::thread _thread;
+  std::atomic<bool> _quit = false;
+
+  spsc_queue<emu_command, 256> _commands;
+  spsc_queue<tuning_result, 8> _results;
+  triple_buffer<frame_snapshot> _frames_out;
+
+  // owned by the emulation thread while it is running
+  audio_context& _audio;
+  std::unique_ptr<chip8vm> _vm;
+  std::optional<cycle_tuner> _tuner;
+  uint64_t _rom_id = 0;
+  int _cycles_per_frame;
+  bool _paused = false;
+  frame_clock _frames{60};
+
+  fast_forward_config _ff;
+  bool _fast_forward = false;
+  // frames emulated since the last one shown while fast forwarding
+  int _frames_unshown = 0;
+
+  // key changes that haven't been applied yet, in the order they happened
+  struct pending_key {
+    time_point time;
+    chip8_key key;
+    bool pressed;
+  };
+  std::vector<pending_key> _pending_keys;
+  // _pending_keys converted to cycles for the frame being emulated
+  std::vector<input_event> _frame_input;
+
+  // copy of _vm that is run ahead to produce the presented frame; never makes sound
+  int _run_ahead;
+  std::unique_ptr<chip8vm> _ahead;
+  duration _run_ahead_acc{0};
+  int _run_ahead_count = 0;
+  float _run_ahead_ms = 0;
+
+  // instructions executed since the last profile update
+  int _cycles_executed = 0;
+  int _cycles_per_second = 0;
+  duration _profile_acc{0};
+
+  // vm whose framebuffer was published last, or nullptr if there is no continuity with it
+  // (run-ahead copies, a newly loaded vm); see publish()
+  const chip8vm* _shown_source = nullptr;
+  uint64_t _shown_generation = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_FILE_WATCHER_HPP
+#define FRONTEND_FILE_WATCHER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// notices when files are written and calls on_change from its own thread once a file has been
+// left alone for the debounce period, so that an editor saving in several steps only triggers
+// one call. uses inotify on linux and polls modification times elsewhere
+class file_watcher {
+public:
+  using callback = std::function<void(const std::string& path)>;
+
+  file_watcher(std::chrono::milliseconds debounce, callback on_change);
+  ~file_watcher();
+
+  file_watcher(const file_watcher&) = delete;
+  file_watcher& operator=(const file_watcher&) = delete;
+
+  // replaces the set of watched files; they don't need to exist yet
+  void watch(std::vector<std::string> paths);
+
+private:
+  void wake();
+  void thread_main();
+#ifdef __linux__
+  // returns false if inotify is unavailable
+  bool run_inotify();
+#endif
+  void run_polling();
+
+  const std::chrono::milliseconds _debounce;
+  const callback _on_change;
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::vector<std::string> _paths;
+  // set by watch() so the thread picks up the new paths
+  bool _paths_changed = false;
+  bool _quit = false;
+#ifdef __linux__
+  // written to wake the thread out of poll()
+  int _wake_fd = -1;
+#endif
+  std::thread _thread;
+};
+
+#endif
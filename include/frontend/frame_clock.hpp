@@ -0,0 +1,55 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_FRAME_CLOCK_HPP
+#define FRONTEND_FRAME_CLOCK_HPP
+
+#include <chrono>
+
+// converts elapsed host time into a whole number of emulated frames
+//
+// time is accumulated as integer clock ticks scaled by the frame rate, so unlike summing
+// floating point frame durations no error builds up over time
+class frame_clock {
+public:
+  using clock = std::chrono::steady_clock;
+  using duration = clock::duration;
+
+  constexpr explicit frame_clock(int rate) : _rate{rate}, _acc{0} {}
+
+  constexpr int rate() const { return _rate; }
+  constexpr duration period() const { return duration{std::chrono::seconds{1}} / _rate; }
+
+  // adds elapsed time and returns the number of frames that became due
+  constexpr int advance(duration elapsed) {
+    _acc += elapsed * _rate;
+    const auto frames = _acc / std::chrono::seconds{1};
+    _acc -= frames * std::chrono::seconds{1};
+    return static_cast<int>(frames);
+  }
+
+  // time remaining until the next frame is due
+  constexpr duration until_next() const {
+    return (duration{std::chrono::seconds{1}} - _acc + duration{_rate - 1}) / _rate;
+  }
+
+  constexpr void reset() { _acc = duration{0}; }
+
+private:
+  int _rate;
+  // elapsed time multiplied by _rate; a frame is due every second of this
+  duration _acc;
+};
+
+#endif
@@ -0,0 +1,84 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_PACER_HPP
+#define FRONTEND_PACER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+enum class vsync_mode {
+  off,
+  on,
+  // like on, but late frames are presented immediately instead of waiting for the next vblank
+  adaptive
+};
+
+// host frame times over the last frame_pacer::STATS_WINDOW frames, in milliseconds
+struct frame_stats {
+  float last_ms = 0;
+  float avg_ms = 0;
+  float min_ms = 0;
+  float max_ms = 0;
+};
+
+// sleeps until shortly before the deadline, then spins; os sleeps routinely overshoot by a
+// millisecond or more which is a large part of a frame
+void precise_sleep_until(std::chrono::steady_clock::time_point deadline);
+
+// keeps the main loop from running faster than frames are needed
+class frame_pacer {
+public:
+  using clock = std::chrono::steady_clock;
+  using duration = clock::duration;
+  using time_point = clock::time_point;
+
+  static constexpr std::size_t STATS_WINDOW = 120;
+
+  // sets the swap interval of the current gl context and returns the mode actually in effect,
+  // which may differ if the driver doesn't support the requested one
+  vsync_mode set_vsync(vsync_mode mode);
+  vsync_mode vsync() const { return _vsync; }
+
+  // refresh rate of the display the window is on; 0 if unknown
+  void set_refresh_rate(int hz) { _refresh_rate = hz; }
+
+  // call once per iteration after presenting. without vsync, sleeps until `deadline`. with
+  // vsync the swap already blocks, so this only sleeps if it returned suspiciously early, e.g.
+  // because the window is hidden
+  void wait(time_point deadline);
+
+  // records a frame without sleeping, for iterations that already blocked on something else
+  void mark();
+
+  const frame_stats& stats() const { return _stats; }
+
+  // when the last frame was recorded by wait() or mark()
+  time_point last_frame() const { return _last; }
+
+private:
+  void record(time_point now);
+
+  vsync_mode _vsync = vsync_mode::off;
+  int _refresh_rate = 0;
+
+  time_point _last{};
+  std::array<float, STATS_WINDOW> _times{};
+  std::size_t _time_index = 0;
+  std::size_t _time_count = 0;
+  frame_stats _stats;
+};
+
+#endif
@@ -16,21 +16,36 @@
 #define FRONTEND_RENDERER_HPP
 
 #include <GL/gl3w.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include "frontend/color.hpp"
 
-class chip8vm;
+class framebuffer;
 
 class renderer {
 public:
   renderer();
   ~renderer();
 
-  void render(const chip8vm* chip8);
+  // draws fb, uploading only the rows that changed since the last call. returns false
+  // without drawing if nothing changed, in which case the previous frame can stay on screen
+  bool render(const framebuffer& fb);
+
+  // makes the next render() draw even if the framebuffer didn't change, e.g. after a resize
+  void invalidate() { redraw = true; }
 
   void set_background_color(const color4f& c) { background = c; }
   void set_foreground_color(const color4f& c) { foreground = c; }
 
 private:
+  // copies rows [first, first + count) of fb into the texture
+  void upload_rows(const framebuffer& fb, int first, int count);
+  // (re)creates the persistently mapped upload ring with room for `segment_size` bytes per
+  // upload; does nothing if the driver doesn't support it
+  void create_upload_ring(std::size_t segment_size);
+  void destroy_upload_ring();
+
   GLuint vertex_buffer = 0;
   GLuint vertex_shader = 0;
   GLuint fragment_shader = 0;
@@ -40,11 +55,27 @@ private:
   GLint background_color = 0;
   GLint foreground_color = 0;
 
+  // framebuffer dimensions; the texture is stride texels wide since each texel holds 8 pixels
   struct output_dimensions {
-    int width, height;
+    int width, height, stride;
   };
 
   output_dimensions dims;
+  // generation of the framebuffer contents in emu_texture
+  uint64_t uploaded_generation = 0;
+  bool redraw = true;
+
+  // uploads go through a ring of segments in one persistently mapped pixel buffer when
+  // GL_ARB_buffer_storage is available, and straight from client memory otherwise. each
+  // segment is fenced so it isn't overwritten while the gpu may still read from it
+  static constexpr int UPLOAD_SEGMENTS = 3;
+  bool has_buffer_storage = false;
+  GLuint upload_buffer = 0;
+  uint8_t* upload_ptr = nullptr;
+  std::size_t upload_segment_size = 0;
+  std::array<GLsync, UPLOAD_SEGMENTS> upload_fences{};
+  int upload_segment = 0;
+
   color4f background;
   color4f foreground;
 };
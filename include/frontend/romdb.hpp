@@ -0,0 +1,60 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_ROMDB_HPP
+#define FRONTEND_ROMDB_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "emu/vm.hpp"
+#include "frontend/keymap.hpp"
+
+// settings known to work for a specific rom
+struct rom_profile {
+  std::optional<int> cycles_per_frame;
+  compat_flags quirks = compat_flags::none;
+  // replaces the bindings of every hex key it mentions
+  keymap keys;
+};
+
+// identifies a rom by its contents
+uint64_t rom_hash(const uint8_t* data, std::size_t size);
+
+// per-rom settings stored in a toml file next to config.toml; the file is not read until the
+// first lookup
+class romdb {
+public:
+  explicit romdb(std::string path);
+
+  // returns nullptr if there is no entry for this rom; throws config_error if the database is
+  // malformed
+  const rom_profile* find(uint64_t hash);
+
+  // records a tuned speed for a rom by appending an entry to the database file; returns false
+  // if the file could not be written
+  bool save_cycles_per_frame(uint64_t hash, int cycles_per_frame);
+
+private:
+  void ensure_loaded();
+  void load();
+
+  std::string _path;
+  bool _loaded = false;
+  std::unordered_map<uint64_t, rom_profile> _index;
+};
+
+#endif
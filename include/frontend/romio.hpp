@@ -17,11 +17,27 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <memory>
+#include <string>
 
 class chip8vm;
+class incremental_assembler;
 
-bool load_rom_from_disk(chip8vm& state, const char* filename);
+// on success, program_size receives the number of bytes loaded at chip8vm::PROGRAM_START
+bool load_rom_from_disk(chip8vm& state, const char* filename, std::size_t& program_size);
 bool load_rom_from_memory(chip8vm& state, const uint8_t* data, std::size_t size);
-bool load_file(chip8vm& state, const char* filename);
+bool load_file(chip8vm& state, const char* filename, std::size_t& program_size);
+
+// reads a whole file into contents. used instead of mapped_file for files that may be rewritten
+// while they're read, which for a mapping means SIGBUS once the file shrinks
+bool read_source(const char* filename, std::string& contents);
+
+// true for .c8s files, which are assembled when loaded
+bool is_source_file(const char* filename);
+// assembles a source file. if it doesn't include other modules, it's assembled with a new
+// assembler, which keeps what it needs to patch the program after the file changes; otherwise
+// assembler is left empty. throws syntax_error and link_error
+bool load_source(chip8vm& state, const char* filename,
+  std::unique_ptr<incremental_assembler>& assembler, std::size_t& program_size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRONTEND_WORKER_HPP
+#define FRONTEND_WORKER_HPP
+
+#include <SDL_events.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// queues fn to run on the main thread the next time it handles events; safe to call from any
+// thread
+void call_on_main_thread(std::function<void()> fn);
+// main thread: runs the function carried by ev if it came from call_on_main_thread; returns
+// false for any other event
+bool run_main_thread_call(const SDL_Event& ev);
+
+// runs jobs one at a time on a background thread. a job returns a completion, which is handed
+// to the main thread with call_on_main_thread, so the main thread only ever sees finished work
+class worker {
+public:
+  using completion = std::function<void()>;
+  using job = std::function<completion()>;
+
+  worker();
+  // waits for the running job; jobs that haven't started are dropped
+  ~worker();
+
+  worker(const worker&) = delete;
+  worker& operator=(const worker&) = delete;
+
+  void post(job j);
+
+private:
+  void thread_main();
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::deque<job> _jobs;
+  bool _quit = false;
+  std::thread _thread;
+};
+
+#endif
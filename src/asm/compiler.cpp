@@ -16,12 +16,23 @@
 #include "asm/lexer.hpp"
 #include "asm/parser.hpp"
 
-std::vector<uint8_t> compile(const char* source) {
+std::vector<uint8_t> compile(std::string_view source) {
   std::vector<uint8_t> bytes;
   lexer l(source);
   parser p(l);
-  for (const ir_instruction& instr : p.parse_instructions()) {
-    write_instruction(bytes, instr);
-  }
+  write_program(bytes, p.parse_program());
   return bytes;
 }
+
+bool compile_into(std::string_view source, uint8_t* output, std::size_t capacity,
+  std::size_t& size) {
+  lexer l(source);
+  parser p(l);
+  const ir_program program = p.parse_program();
+  if (program.size() > capacity) {
+    return false;
+  }
+  write_program(output, program);
+  size = program.size();
+  return true;
+}
@@ -0,0 +1,392 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "asm/incremental.hpp"
+#include "asm/lexer.hpp"
+#include <algorithm>
+#include <iterator>
+
+// characters that can end the text before a statement without joining its first token
+static bool is_separator(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ':';
+}
+
+// line and column of offset, counted the same way the lexer does
+static source_location locate(std::string_view source, std::size_t offset) {
+  source_location loc;
+  loc.line = 1 + static_cast<int>(std::count(source.begin(), source.begin() + offset, '\n'));
+  const std::size_t newline = offset ? source.rfind('\n', offset - 1) : std::string_view::npos;
+  const std::size_t line_start = newline == std::string_view::npos ? 0 : newline + 1;
+  loc.pos = static_cast<int>(offset - line_start) + 1;
+  return loc;
+}
+
+// ranges of the bytes that differ between before and after
+static std::vector<byte_range> diff(
+  const std::vector<uint8_t>& before, const std::vector<uint8_t>& after) {
+  std::vector<byte_range> changes;
+  const std::size_t common = std::min(before.size(), after.size());
+  std::size_t i = 0;
+  while (i < common) {
+    if (before[i] == after[i]) {
+      ++i;
+      continue;
+    }
+    const std::size_t start = i;
+    while (i < common && before[i] != after[i])
+      ++i;
+    changes.push_back({start, i - start});
+  }
+  if (before.size() != after.size()) {
+    const std::size_t end = std::max(before.size(), after.size());
+    if (!changes.empty() && changes.back().offset + changes.back().size == common)
+      changes.back().size = end - changes.back().offset;
+    else
+      changes.push_back({common, end - common});
+  }
+  return changes;
+}
+
+// sorts ranges and joins the ones that touch
+static void merge_ranges(std::vector<byte_range>& ranges) {
+  std::sort(ranges.begin(), ranges.end(),
+    [](const byte_range& x, const byte_range& y) { return x.offset < y.offset; });
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    if (out && ranges[out - 1].offset + ranges[out - 1].size >= ranges[i].offset) {
+      byte_range& last = ranges[out - 1];
+      last.size = std::max(last.offset + last.size, ranges[i].offset + ranges[i].size) -
+                  last.offset;
+    } else {
+      ranges[out++] = ranges[i];
+    }
+  }
+  ranges.resize(out);
+}
+
+void incremental_assembler::assemble(std::string source) {
+  incremental_assembler result;
+  result.build(std::move(source));
+  *this = std::move(result);
+}
+
+void incremental_assembler::build(std::string source) {
+  _source = std::move(source);
+  std::size_t end_address = BASE_ADDRESS;
+  // duplicate labels are reported by the parser since the range is the whole source
+  _statements = parse_range(0, _source.size(), end_address);
+
+  for (const statement& s : _statements) {
+    if (!s.label.empty())
+      _labels.emplace(s.label, s.instr.address);
+  }
+
+  _bytes.resize(end_address - BASE_ADDRESS);
+  std::vector<byte_range> unused;
+  for (statement& s : _statements) {
+    if (s.instr.label_ref.size() && !resolve(s.instr))
+      error("undefined label", s, s.instr.label_ref);
+    write_statement(s, unused);
+  }
+  _valid = true;
+}
+
+std::vector<byte_range> incremental_assembler::rebuild(std::string source) {
+  incremental_assembler result;
+  result.build(std::move(source));
+  std::vector<byte_range> changes = diff(_bytes, result._bytes);
+  *this = std::move(result);
+  return changes;
+}
+
+std::vector<byte_range> incremental_assembler::update(std::string source) {
+  if (!_valid)
+    return rebuild(std::move(source));
+
+  const std::string_view before = _source;
+  const std::string_view after = source;
+  if (before == after) {
+    _parsed = 0;
+    return {};
+  }
+
+  // the edit replaced before[prefix, before.size() - suffix)
+  const std::size_t prefix =
+    std::mismatch(before.begin(), before.end(), after.begin(), after.end()).first -
+    before.begin();
+  const std::size_t max_suffix = std::min(before.size(), after.size()) - prefix;
+  std::size_t suffix = 0;
+  while (suffix < max_suffix &&
+         before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+    ++suffix;
+  }
+
+  // a ';' added or removed by the edit changes everything up to the end of its line
+  const std::size_t line_end = after.find('\n', after.size() - suffix);
+  const std::size_t change_end =
+    (line_end == std::string_view::npos ? after.size() : line_end) + before.size() - after.size();
+
+  // statements [first, last) are re-parsed: the ones the edit touched plus one on either side,
+  // in case the edit joined a token to its neighbour
+  const auto begins_after = [&](std::size_t offset) {
+    return static_cast<std::size_t>(
+      std::upper_bound(_statements.begin(), _statements.end(), offset,
+        [](std::size_t o, const statement& s) { return o < s.begin; }) -
+      _statements.begin());
+  };
+  const std::size_t count = _statements.size();
+  std::size_t first = begins_after(prefix);
+  first = first > 2 ? first - 2 : 0;
+  const std::size_t last = std::min(count, begins_after(change_end) + 1);
+
+  const std::size_t region_begin = first ? _statements[first].begin : 0;
+  const std::size_t region_old_end = last < count ? _statements[last].begin : before.size();
+  const std::size_t region_new_end = region_old_end + after.size() - before.size();
+
+  // the statements kept on either side must still start where a token starts; otherwise only
+  // parsing everything gives the right answer
+  if ((region_begin && !is_separator(after[region_begin - 1])) ||
+      (last < count && region_new_end && !is_separator(after[region_new_end - 1]))) {
+    return rebuild(std::move(source));
+  }
+
+  const std::size_t end_address = BASE_ADDRESS + _bytes.size();
+  const std::size_t address_begin = first < count ? _statements[first].instr.address : end_address;
+  const std::size_t old_region_end = last < count ? _statements[last].instr.address : end_address;
+
+  _source = std::move(source);
+  std::vector<statement> region;
+  std::size_t new_region_end = address_begin;
+  try {
+    region = parse_range(region_begin, region_new_end, new_region_end);
+  } catch (const syntax_error&) {
+    // reparse everything so the error carries the right position
+    _valid = false;
+    return rebuild(std::move(_source));
+  }
+
+  try {
+    const std::ptrdiff_t source_delta =
+      static_cast<std::ptrdiff_t>(region_new_end) - static_cast<std::ptrdiff_t>(region_old_end);
+    const std::ptrdiff_t size_delta =
+      static_cast<std::ptrdiff_t>(new_region_end) - static_cast<std::ptrdiff_t>(old_region_end);
+
+    // labels whose address changed, appeared or disappeared
+    std::vector<std::string_view> changed_labels;
+    for (std::size_t i = first; i < last; ++i) {
+      const statement& s = _statements[i];
+      if (!s.label.empty()) {
+        _labels.erase(s.label);
+        changed_labels.push_back(s.label);
+      }
+      if (s.instr.is_data())
+        _live_data -= s.instr.data_size;
+    }
+    for (std::size_t i = last; i < count; ++i) {
+      statement& s = _statements[i];
+      s.begin += source_delta;
+      if (size_delta) {
+        s.instr.address += size_delta;
+        if (!s.label.empty()) {
+          _labels[s.label] = s.instr.address;
+          changed_labels.push_back(s.label);
+        }
+      }
+    }
+
+    // splice the new statements in
+    const std::size_t region_size = region.size();
+    if (region_size <= last - first) {
+      std::move(region.begin(), region.end(), _statements.begin() + first);
+      _statements.erase(_statements.begin() + first + region_size, _statements.begin() + last);
+    } else {
+      std::move(region.begin(), region.begin() + (last - first), _statements.begin() + first);
+      _statements.insert(_statements.begin() + last,
+        std::make_move_iterator(region.begin() + (last - first)),
+        std::make_move_iterator(region.end()));
+    }
+    const std::size_t region_last = first + region_size;
+
+    for (std::size_t i = first; i < region_last; ++i) {
+      const statement& s = _statements[i];
+      if (!s.label.empty()) {
+        if (!_labels.emplace(s.label, s.instr.address).second)
+          error("duplicate label", s, s.label);
+        changed_labels.push_back(s.label);
+      }
+    }
+
+    // only references to changed labels need resolving again
+    std::vector<std::size_t> touched;
+    for (std::size_t i = first; i < region_last; ++i) {
+      statement& s = _statements[i];
+      if (s.instr.label_ref.size() && !resolve(s.instr))
+        error("undefined label", s, s.instr.label_ref);
+    }
+    if (!changed_labels.empty()) {
+      const std::unordered_set<std::string_view> changed(
+        changed_labels.begin(), changed_labels.end());
+      const auto resolve_changed = [&](std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i < to; ++i) {
+          statement& s = _statements[i];
+          if (s.instr.label_ref.size() && changed.count(s.instr.label_ref)) {
+            if (!resolve(s.instr))
+              error("undefined label", s, s.instr.label_ref);
+            touched.push_back(i);
+          }
+        }
+      };
+      resolve_changed(0, first);
+      resolve_changed(region_last, _statements.size());
+    }
+
+    // nothing can fail past this point, so bytes can be updated
+    std::vector<byte_range> changes;
+    const std::size_t old_size = _bytes.size();
+    const std::size_t region_offset = address_begin - BASE_ADDRESS;
+    if (size_delta) {
+      // everything after the region moves
+      const std::size_t new_size = old_size + size_delta;
+      const std::size_t old_tail = old_region_end - BASE_ADDRESS;
+      const std::size_t new_tail = new_region_end - BASE_ADDRESS;
+      if (size_delta > 0) {
+        _bytes.resize(new_size);
+        std::copy_backward(_bytes.begin() + old_tail, _bytes.begin() + old_size, _bytes.end());
+      } else {
+        std::copy(_bytes.begin() + old_tail, _bytes.end(), _bytes.begin() + new_tail);
+        _bytes.resize(new_size);
+      }
+      changes.push_back({region_offset, std::max(old_size, new_size) - region_offset});
+    }
+    for (std::size_t i = first; i < region_last; ++i)
+      write_statement(_statements[i], changes);
+    for (std::size_t i : touched)
+      write_statement(_statements[i], changes);
+    merge_ranges(changes);
+
+    for (std::size_t i = first; i < region_last; ++i) {
+      if (_statements[i].instr.is_data())
+        _live_data += _statements[i].instr.data_size;
+    }
+    if (_data.size() > 2 * _live_data + 4096)
+      compact_data();
+
+    return changes;
+  } catch (const syntax_error&) {
+    // the statements were partially updated; bytes() is still intact
+    _valid = false;
+    throw;
+  }
+}
+
+std::vector<incremental_assembler::statement> incremental_assembler::parse_range(
+  std::size_t begin, std::size_t end, std::size_t& address) {
+  const std::string_view text = std::string_view(_source).substr(begin, end - begin);
+  lexer lex(text);
+  parser p(lex, address);
+
+  std::vector<statement> statements;
+  while (!p.at_end()) {
+    const std::string_view first = lex.current().span;
+    const source_location loc = lex.current().location;
+    statement s;
+    s.begin = begin + static_cast<std::size_t>(first.data() - text.data());
+    const statement_type type = p.parse_statement();
+    if (type == statement_type::include) {
+      // modules are linked by asm/module.hpp; there is nothing here to patch them into
+      throw syntax_error("include is only supported when assembling files", loc.line, loc.pos,
+        std::string(first));
+    } else if (type == statement_type::label) {
+      s.label = intern(first);
+      s.instr.address = p.address();
+    } else {
+      s.instr = p.program().instructions.back();
+      s.instr.label_ref = intern(s.instr.label_ref);
+      if (s.instr.is_data()) {
+        const uint8_t* payload = p.program().payload(s.instr);
+        s.instr.data_offset = static_cast<uint32_t>(_data.size());
+        _data.insert(_data.end(), payload, payload + s.instr.data_size);
+        _live_data += s.instr.data_size;
+      }
+    }
+    statements.push_back(s);
+  }
+
+  _parsed = statements.size();
+  address = p.address();
+  return statements;
+}
+
+std::string_view incremental_assembler::intern(std::string_view name) {
+  if (name.empty())
+    return {};
+  if (auto it = _name_index.find(name); it != _name_index.end())
+    return *it;
+  return *_name_index.insert(_names.emplace_back(name)).first;
+}
+
+bool incremental_assembler::resolve(ir_instruction& instr) const {
+  auto it = _labels.find(instr.label_ref);
+  if (it == _labels.end())
+    return false;
+  const int address = static_cast<int>(it->second);
+  if (instr.m->a == operand_type::addr)
+    instr.a = address;
+  if (instr.m->b == operand_type::addr)
+    instr.b = address;
+  if (instr.m->c == operand_type::addr)
+    instr.c = address;
+  return true;
+}
+
+void incremental_assembler::write_statement(const statement& s, std::vector<byte_range>& changes) {
+  if (!s.size())
+    return;
+
+  uint8_t opcode[2];
+  const uint8_t* bytes = opcode;
+  if (s.instr.is_data()) {
+    bytes = _data.data() + s.instr.data_offset;
+  } else {
+    const uint16_t op = encode_instruction(s.instr);
+    opcode[0] = (op & 0xFF00) >> 8;
+    opcode[1] = (op & 0x00FF) >> 0;
+  }
+
+  const std::size_t offset = s.instr.address - BASE_ADDRESS;
+  uint8_t* dest = _bytes.data() + offset;
+  if (!std::equal(bytes, bytes + s.size(), dest)) {
+    std::copy(bytes, bytes + s.size(), dest);
+    changes.push_back({offset, s.size()});
+  }
+}
+
+void incremental_assembler::compact_data() {
+  std::vector<uint8_t> data;
+  data.reserve(_live_data);
+  for (statement& s : _statements) {
+    if (s.instr.is_data()) {
+      const uint8_t* payload = _data.data() + s.instr.data_offset;
+      s.instr.data_offset = static_cast<uint32_t>(data.size());
+      data.insert(data.end(), payload, payload + s.instr.data_size);
+    }
+  }
+  _data = std::move(data);
+}
+
+void incremental_assembler::error(
+  const char* msg, const statement& s, std::string_view context) const {
+  const source_location loc = locate(_source, s.begin);
+  throw syntax_error(msg, loc.line, loc.pos, std::string(context));
+}
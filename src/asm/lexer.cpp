@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include "asm/lexer.hpp"
+#include "common/fnv1a.hpp"
+#include <array>
 #include <charconv>
 
 bool is_alpha(char ch) {
@@ -72,6 +74,204 @@ int variable_id(std::string_view s) {
   }
 }
 
+// character classes the lexer skips over in bulk. each provides a scalar test and, where
+// available, a vector test producing 0xFF in every lane that belongs to the class
+#if defined(__AVX2__)
+#define ULTIM8_LEXER_SIMD
+#include <immintrin.h>
+
+using simd_block = __m256i;
+constexpr std::size_t SIMD_WIDTH = 32;
+constexpr uint32_t SIMD_ALL_LANES = 0xFFFFFFFF;
+
+inline simd_block simd_load(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+inline simd_block simd_splat(char ch) { return _mm256_set1_epi8(ch); }
+inline simd_block simd_eq(simd_block x, simd_block y) { return _mm256_cmpeq_epi8(x, y); }
+inline simd_block simd_gt(simd_block x, simd_block y) { return _mm256_cmpgt_epi8(x, y); }
+inline simd_block simd_or(simd_block x, simd_block y) { return _mm256_or_si256(x, y); }
+inline simd_block simd_and(simd_block x, simd_block y) { return _mm256_and_si256(x, y); }
+inline uint32_t simd_lanes(simd_block x) { return static_cast<uint32_t>(_mm256_movemask_epi8(x)); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ULTIM8_LEXER_SIMD
+#include <emmintrin.h>
+
+using simd_block = __m128i;
+constexpr std::size_t SIMD_WIDTH = 16;
+constexpr uint32_t SIMD_ALL_LANES = 0xFFFF;
+
+inline simd_block simd_load(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+inline simd_block simd_splat(char ch) { return _mm_set1_epi8(ch); }
+inline simd_block simd_eq(simd_block x, simd_block y) { return _mm_cmpeq_epi8(x, y); }
+inline simd_block simd_gt(simd_block x, simd_block y) { return _mm_cmpgt_epi8(x, y); }
+inline simd_block simd_or(simd_block x, simd_block y) { return _mm_or_si128(x, y); }
+inline simd_block simd_and(simd_block x, simd_block y) { return _mm_and_si128(x, y); }
+inline uint32_t simd_lanes(simd_block x) { return static_cast<uint32_t>(_mm_movemask_epi8(x)); }
+#endif
+
+#ifdef ULTIM8_LEXER_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+inline int count_trailing_zeros(uint32_t x) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, x);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(x);
+#endif
+}
+
+// lanes holding a character in [first, last]; the signed compare is fine since neither bound
+// is above 0x7F and bytes above it compare as negative
+inline simd_block simd_in_range(simd_block x, char first, char last) {
+  return simd_and(simd_gt(x, simd_splat(first - 1)), simd_gt(simd_splat(last + 1), x));
+}
+#endif
+
+// spaces, tabs and carriage returns; newlines are handled separately to count lines
+struct blank_class {
+  static bool match(char ch) { return is_whitespace(ch) || ch == '\r'; }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) {
+    return simd_or(simd_or(simd_eq(x, simd_splat(' ')), simd_eq(x, simd_splat('\t'))),
+      simd_eq(x, simd_splat('\r')));
+  }
+#endif
+};
+
+// anything up to the end of the line
+struct comment_class {
+  static bool match(char ch) { return ch != '\r' && ch != '\n'; }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) {
+    const simd_block line_end = simd_or(simd_eq(x, simd_splat('\r')), simd_eq(x, simd_splat('\n')));
+    return simd_eq(line_end, simd_splat(0));
+  }
+#endif
+};
+
+struct name_class {
+  static bool match(char ch) { return is_name_char(ch); }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) {
+    return simd_or(simd_or(simd_in_range(x, 'a', 'z'), simd_in_range(x, '0', '9')),
+      simd_eq(x, simd_splat('_')));
+  }
+#endif
+};
+
+struct dec_class {
+  static bool match(char ch) { return is_num(ch); }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) { return simd_in_range(x, '0', '9'); }
+#endif
+};
+
+struct hex_class {
+  static bool match(char ch) { return is_hexnum(ch); }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) {
+    return simd_or(simd_or(simd_in_range(x, '0', '9'), simd_in_range(x, 'a', 'f')),
+      simd_in_range(x, 'A', 'F'));
+  }
+#endif
+};
+
+struct bin_class {
+  static bool match(char ch) { return is_binnum(ch); }
+#ifdef ULTIM8_LEXER_SIMD
+  static simd_block match(simd_block x) {
+    return simd_or(simd_eq(x, simd_splat('0')), simd_eq(x, simd_splat('1')));
+  }
+#endif
+};
+
+// returns the first character in [p, end) that doesn't belong to Class, or end
+template <typename Class>
+const char* skip_class(const char* p, const char* end) {
+#ifdef ULTIM8_LEXER_SIMD
+  // whole blocks only, so nothing past end is ever read
+  while (static_cast<std::size_t>(end - p) >= SIMD_WIDTH) {
+    const uint32_t lanes = simd_lanes(Class::match(simd_load(p)));
+    if (lanes != SIMD_ALL_LANES)
+      return p + count_trailing_zeros(~lanes);
+    p += SIMD_WIDTH;
+  }
+#endif
+  while (p != end && Class::match(*p))
+    ++p;
+  return p;
+}
+
+// names with a meaning of their own
+struct keyword {
+  std::string_view name;
+  token_type type = token_type::text;
+  int mnemonic = -1;
+};
+
+constexpr std::size_t KEYWORD_COUNT = 3 + opmetas.mnemonic_count();
+
+constexpr std::array<keyword, KEYWORD_COUNT> make_keywords() {
+  std::array<keyword, KEYWORD_COUNT> words{};
+  words[0] = {"i", token_type::i};
+  words[1] = {"dt", token_type::dt};
+  words[2] = {"st", token_type::st};
+  for (std::size_t id = 0; id < opmetas.mnemonic_count(); ++id) {
+    const int mnemonic = static_cast<int>(id);
+    words[3 + id] = {opmetas.mnemonic_name(mnemonic), token_type::mnemonic, mnemonic};
+  }
+  return words;
+}
+
+// perfect hash of all keywords: every keyword gets its own slot, so recognizing a name takes
+// one hash and one string comparison
+constexpr std::size_t KEYWORD_SLOTS = 256;
+
+struct keyword_table {
+  uint64_t seed = 0;
+  std::array<keyword, KEYWORD_SLOTS> slots{};
+};
+
+constexpr std::size_t keyword_slot(std::string_view name, uint64_t seed) {
+  return static_cast<std::size_t>(fnv1a(name, seed) % KEYWORD_SLOTS);
+}
+
+// tries seeds until one places every keyword in a different slot; with this many slots that
+// happens within the first few attempts
+constexpr keyword_table build_keyword_table() {
+  constexpr std::array<keyword, KEYWORD_COUNT> words = make_keywords();
+  for (uint64_t seed = FNV1A_OFFSET_BASIS;; ++seed) {
+    keyword_table table;
+    table.seed = seed;
+    bool collision = false;
+    for (const keyword& w : words) {
+      keyword& slot = table.slots[keyword_slot(w.name, seed)];
+      if (!slot.name.empty()) {
+        collision = true;
+        break;
+      }
+      slot = w;
+    }
+    if (!collision)
+      return table;
+  }
+}
+
+constexpr keyword_table KEYWORDS = build_keyword_table();
+
+const keyword* find_keyword(std::string_view name) {
+  const keyword& k = KEYWORDS.slots[keyword_slot(name, KEYWORDS.seed)];
+  // unused slots have an empty name, which never matches since names aren't empty
+  return k.name == name ? &k : nullptr;
+}
+
 template <typename Integer>
 std::from_chars_result from_chars_sv(std::string_view view, Integer& i, int base = 10) {
   return std::from_chars(
@@ -79,9 +279,9 @@ std::from_chars_result from_chars_sv(std::string_view view, Integer& i, int base
   );
 }
 
-lexer::lexer(std::string source)
-    : _source{std::move(source)}, _ptr{_source.data()}, _line{1}, _pos{1}, _lookahead{
-                                                                             token_type::uninit} {
+lexer::lexer(std::string_view source)
+    : _ptr{source.data()}, _end{source.data() + source.size()}, _line_start{source.data()},
+      _line{1}, _lookahead{token_type::uninit} {
 }
 
 void lexer::next() {
@@ -93,41 +293,31 @@ void lexer::next() {
   }
 }
 
-char lexer::read_one() {
-  ++_pos;
-  ++_ptr;
-  return *_ptr;
-}
-
 token lexer::lex_one() {
   for (;;) {
+    if (_ptr == _end)
+      return make_token(token_type::eos);
     char ch = *_ptr;
     switch (ch) {
     case ';':
       read_comment();
       break;
     case '\r':
-      read_one();
+    case ' ':
+    case '\t':
+      _ptr = skip_class<blank_class>(_ptr, _end);
       break;
     case '\n':
-      read_one();
+      ++_ptr;
       new_line();
       break;
-    case ' ':
-    case '\t':
-      read_one();
-      break;
     case ':':
-      read_one();
-      return make_token(token_type::colon);
+      return read_punctuation(token_type::colon);
     case ',':
-      read_one();
-      return make_token(token_type::comma);
+      return read_punctuation(token_type::comma);
     case '0': case '1': case '2': case '3': case '4':
     case '5': case '6': case '7': case '8': case '9':
       return read_number();
-    case '\0':
-      return make_token(token_type::eos);
     default:
       if (is_alpha(ch) || ch == '_') {
         return read_name();
@@ -140,44 +330,47 @@ token lexer::lex_one() {
 
 void lexer::new_line() {
   ++_line;
-  _pos = 1;
+  _line_start = _ptr;
 }
 
 void lexer::read_comment() {
-  while (*_ptr != '\r' && *_ptr != '\n') {
-    ++_ptr;
-  }
+  _ptr = skip_class<comment_class>(_ptr, _end);
+}
+
+token lexer::read_punctuation(token_type type) {
+  token t = make_token(type);
+  t.span = std::string_view{_ptr, 1};
+  ++_ptr;
+  return t;
 }
 
 token lexer::read_number() {
   enum num_type { dec, hex, bin };
 
   num_type num_ty = dec;
-  char* start = _ptr;
+  token t = make_token(token_type::number);
+  const char* start = _ptr;
 
   // determine what kind of number we're dealing with
-  if (*_ptr == '0' && *(_ptr + 1) == 'x') {
+  if (peek() == '0' && peek(1) == 'x') {
     num_ty = hex;
     _ptr += 2;
     start = _ptr;
-  } else if (*_ptr == '0' && *(_ptr + 1) == 'b') {
+  } else if (peek() == '0' && peek(1) == 'b') {
     num_ty = bin;
     _ptr += 2;
     start = _ptr;
   }
 
   if (num_ty == hex) {
-    while (is_hexnum(read_one())) {
-    }
+    _ptr = skip_class<hex_class>(_ptr, _end);
   } else if (num_ty == bin) {
-    while (is_binnum(read_one())) {
-    }
+    _ptr = skip_class<bin_class>(_ptr, _end);
   } else {
-    while (is_num(read_one())) {
-    }
+    _ptr = skip_class<dec_class>(_ptr, _end);
   }
 
-  char* end = _ptr;
+  const char* end = _ptr;
 
   std::string_view view{start, static_cast<std::size_t>(end - start)};
 
@@ -189,7 +382,6 @@ token lexer::read_number() {
   case bin: from_chars_sv(view, value, 2); break;
   }
 
-  token t = make_token(token_type::number);
   t.span = view;
   t.numeric_value = value;
   return t;
@@ -197,33 +389,28 @@ token lexer::read_number() {
 
 token lexer::read_name() {
   token t = make_token(token_type::text);
-  char* start = _ptr;
-  while (is_name_char(read_one())) {}
-  char* end = _ptr;
+  const char* start = _ptr;
+  _ptr = skip_class<name_class>(_ptr, _end);
+  const char* end = _ptr;
   t.span = std::string_view{start, static_cast<std::size_t>(end - start)};
-  if (t.span == "i") {
-    t.type = token_type::i;
-  } else if (t.span == "dt") {
-    t.type = token_type::dt;
-  } else if (t.span == "st") {
-    t.type = token_type::st;
+  if (const keyword* k = find_keyword(t.span)) {
+    t.type = k->type;
+    t.mnemonic = k->mnemonic;
   } else if (is_variable_name(t.span)) {
     t.type = token_type::variable;
     t.numeric_value = variable_id(t.span);
-  } else if (_omtbl.is_mnemonic(t.span)) {
-    t.type = token_type::mnemonic;
   }
   return t;
 }
 
 void lexer::error(const char* msg) {
-  throw syntax_error(msg, _line, _pos, std::string(current().span));
+  throw syntax_error(msg, _line, pos(), std::string(current().span));
 }
 
 token lexer::make_token(token_type type) {
   token t;
   t.type = type;
   t.location.line = _line;
-  t.location.pos = _pos;
+  t.location.pos = pos();
   return t;
 }
\ No newline at end of file
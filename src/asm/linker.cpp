@@ -0,0 +1,64 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "asm/linker.hpp"
+#include "asm/error.hpp"
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+std::vector<uint8_t> link(const std::vector<link_input>& inputs, std::size_t address) {
+  std::vector<std::size_t> offsets;
+  offsets.reserve(inputs.size());
+  std::size_t size = 0;
+  for (const link_input& in : inputs) {
+    offsets.push_back(size);
+    size += in.object->code.size();
+  }
+
+  // label name -> address, and the input defining it
+  struct symbol {
+    std::size_t address;
+    std::size_t input;
+  };
+  std::unordered_map<std::string_view, symbol> symbols;
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    for (const object_symbol& sym : inputs[i].object->symbols) {
+      const symbol s{address + offsets[i] + sym.offset, i};
+      if (!symbols.try_emplace(sym.name, s).second) {
+        throw link_error("duplicate label", sym.name, inputs[i].name);
+      }
+    }
+  }
+
+  std::vector<uint8_t> output(size);
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    const object_file& object = *inputs[i].object;
+    std::copy(object.code.begin(), object.code.end(), output.begin() + offsets[i]);
+
+    for (const object_relocation& rel : object.relocations) {
+      auto it = symbols.find(rel.symbol);
+      if (it == symbols.end()) {
+        throw link_error("undefined label", rel.symbol, inputs[i].name, rel.line, rel.pos);
+      }
+      // addresses are always the low 12 bits of the instruction
+      const std::size_t target = it->second.address;
+      uint8_t* instr = &output[offsets[i] + rel.offset];
+      instr[0] = static_cast<uint8_t>((instr[0] & 0xF0) | ((target >> 8) & 0x0F));
+      instr[1] = static_cast<uint8_t>(target & 0xFF);
+    }
+  }
+
+  return output;
+}
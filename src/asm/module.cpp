@@ -0,0 +1,222 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "asm/module.hpp"
+#include "asm/error.hpp"
+#include "asm/lexer.hpp"
+#include "asm/linker.hpp"
+#include "asm/object.hpp"
+#include "common/fnv1a.hpp"
+#include "common/mapped_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+struct module {
+  fs::path path;
+  object_file object;
+  // the include statement that first named this module; included_from is empty for the root
+  std::string included_from;
+  object_include include;
+  bool cached = false;
+  // set if building the module failed; rethrown once every module of its wave is done
+  std::exception_ptr error;
+};
+
+static fs::path cache_path(const module_options& options, uint64_t source_hash) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.u8o", static_cast<unsigned long long>(source_hash));
+  return fs::path(options.cache_dir) / name;
+}
+
+static bool read_cached_object(const fs::path& path, uint64_t source_hash, object_file& object) {
+  mapped_file file(path.string().c_str());
+  return file.is_open() &&
+         read_object(reinterpret_cast<const uint8_t*>(file.data()), file.size(), source_hash,
+           object);
+}
+
+// failing to write to the cache only costs time on the next build, so errors are ignored
+static void write_cached_object(
+  const fs::path& path, uint64_t source_hash, const object_file& object) {
+  std::vector<uint8_t> bytes;
+  write_object(bytes, object, source_hash);
+
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+
+  // written under a temporary name first, so a build running at the same time never sees a
+  // partially written object
+  fs::path temp = path;
+  temp += "." + std::to_string(std::random_device{}()) + ".tmp";
+  std::ofstream file(temp, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  file.close();
+  if (file)
+    fs::rename(temp, path, ec);
+  if (!file || ec)
+    fs::remove(temp, ec);
+}
+
+// sources are read rather than mapped: an editor may truncate a file while it's being built
+static bool read_source_file(const fs::path& path, std::string& contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+static void build_module(module& m, const module_options& options) {
+  const bool root = m.included_from.empty();
+  std::string contents;
+  std::string_view source;
+  if (root && options.root_source) {
+    source = *options.root_source;
+  } else if (read_source_file(m.path, contents)) {
+    source = contents;
+  } else {
+    if (root)
+      throw std::runtime_error("unable to open " + m.path.string());
+    syntax_error e("module not found", m.include.line, m.include.pos, m.include.name);
+    e.file = m.included_from;
+    throw e;
+  }
+
+  // optimized and unoptimized objects of the same source are cached separately
+  const uint64_t hash = fnv1a(options.optimize ? "O" : "", fnv1a(source));
+  const bool use_cache = !options.cache_dir.empty();
+  if (use_cache && read_cached_object(cache_path(options, hash), hash, m.object)) {
+    m.cached = true;
+    return;
+  }
+
+  try {
+    m.object = assemble_object(source, options.optimize);
+  } catch (syntax_error& e) {
+    e.file = m.path.string();
+    throw;
+  }
+
+  if (use_cache)
+    write_cached_object(cache_path(options, hash), hash, m.object);
+}
+
+// builds modules[first, modules.size()) in parallel
+static void build_modules(std::vector<module>& modules, std::size_t first,
+  const module_options& options) {
+  const std::size_t count = modules.size() - first;
+  const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+  const std::size_t thread_count =
+    std::min<std::size_t>(options.threads ? options.threads : hardware_threads, count);
+
+  std::atomic<std::size_t> next{first};
+  const auto run = [&]() {
+    for (std::size_t i = next++; i < modules.size(); i = next++) {
+      try {
+        build_module(modules[i], options);
+      } catch (...) {
+        modules[i].error = std::current_exception();
+      }
+    }
+  };
+
+  // the calling thread takes a share too
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(run);
+  run();
+  for (std::thread& t : threads)
+    t.join();
+
+  // report the first failure in include order, so the error doesn't depend on timing
+  for (std::size_t i = first; i < modules.size(); ++i) {
+    if (modules[i].error)
+      std::rethrow_exception(modules[i].error);
+  }
+}
+
+// the same file reached through different relative paths is still one module
+static std::string module_key(const fs::path& path) {
+  std::error_code ec;
+  fs::path canonical = fs::weakly_canonical(path, ec);
+  return ec ? path.lexically_normal().string() : canonical.string();
+}
+
+std::vector<uint8_t> assemble_modules(const std::string& root_path,
+  const module_options& options, module_stats* stats, std::size_t address) {
+  std::vector<module> modules(1);
+  modules[0].path = root_path;
+  std::unordered_set<std::string> seen{module_key(root_path)};
+
+  // modules are built in waves: the includes of one wave are only known once it has been
+  // assembled (or read from the cache), and make up the next
+  for (std::size_t first = 0; first < modules.size();) {
+    const std::size_t last = modules.size();
+    build_modules(modules, first, options);
+
+    for (std::size_t i = first; i < last; ++i) {
+      for (const object_include& inc : modules[i].object.includes) {
+        fs::path path = modules[i].path.parent_path() / (inc.name + ".c8s");
+        if (!seen.insert(module_key(path)).second)
+          continue;
+        module m;
+        m.path = std::move(path);
+        m.included_from = modules[i].path.string();
+        m.include = inc;
+        modules.push_back(std::move(m));
+      }
+    }
+    first = last;
+  }
+
+  std::vector<link_input> inputs;
+  inputs.reserve(modules.size());
+  for (const module& m : modules) {
+    inputs.push_back({m.path.string(), &m.object});
+    if (stats) {
+      ++(m.cached ? stats->cached : stats->assembled);
+      stats->optimized += m.object.optimized;
+    }
+  }
+
+  return link(inputs, address);
+}
+
+bool has_includes(std::string_view source) {
+  try {
+    lexer lex(source);
+    // a name following a mnemonic or comma is an operand, not the start of a statement
+    token_type previous = token_type::eos;
+    for (lex.next(); lex.current().type != token_type::eos; lex.next()) {
+      const bool operand = previous == token_type::mnemonic || previous == token_type::comma;
+      if (!operand && lex.current().type == token_type::text &&
+          lex.current().span == "include" && lex.lookahead().type == token_type::text)
+        return true;
+      previous = lex.current().type;
+    }
+  } catch (const syntax_error&) {
+    // assembling the source reports this properly
+  }
+  return false;
+}
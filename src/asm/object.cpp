@@ -0,0 +1,219 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "asm/object.hpp"
+#include "asm/lexer.hpp"
+#include "asm/parser.hpp"
+#include <algorithm>
+#include <cstring>
+
+object_file assemble_object(std::string_view source, bool optimize) {
+  lexer lex(source);
+  parser p(lex, 0);
+  while (!p.at_end()) {
+    p.parse_statement();
+  }
+
+  object_file object;
+  if (optimize) {
+    object.optimized = p.optimize();
+  }
+
+  const ir_program& program = p.program();
+  write_program(object.code, program);
+
+  for (const auto& [name, address] : p.labels()) {
+    object.symbols.push_back({std::string(name), static_cast<uint32_t>(address)});
+  }
+  // the label map is unordered; keep objects byte for byte reproducible
+  std::sort(object.symbols.begin(), object.symbols.end(),
+    [](const object_symbol& x, const object_symbol& y) {
+      return x.offset != y.offset ? x.offset < y.offset : x.name < y.name;
+    });
+
+  for (const label_fixup& fixup : p.fixups()) {
+    const ir_instruction& instr = program.instructions[fixup.instr_index];
+    object.relocations.push_back({static_cast<uint32_t>(instr.address),
+      std::string(instr.label_ref), fixup.line, fixup.pos});
+  }
+
+  for (const module_include& inc : program.includes) {
+    object.includes.push_back({std::string(inc.name), inc.line, inc.pos});
+  }
+
+  return object;
+}
+
+// bumped whenever the encoding or the way sources assemble changes, so stale cached objects
+// are assembled again
+constexpr uint32_t OBJECT_VERSION = 2;
+constexpr char OBJECT_MAGIC[4] = {'U', '8', 'O', 'B'};
+
+// integers are stored little endian regardless of the host
+static void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+  put_u32(out, static_cast<uint32_t>(v));
+  put_u32(out, static_cast<uint32_t>(v >> 32));
+}
+
+static void put_bytes(std::vector<uint8_t>& out, const void* data, std::size_t size) {
+  put_u32(out, static_cast<uint32_t>(size));
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+void write_object(std::vector<uint8_t>& output, const object_file& object, uint64_t source_hash) {
+  output.insert(output.end(), std::begin(OBJECT_MAGIC), std::end(OBJECT_MAGIC));
+  put_u32(output, OBJECT_VERSION);
+  put_u64(output, source_hash);
+
+  put_bytes(output, object.code.data(), object.code.size());
+
+  put_u32(output, static_cast<uint32_t>(object.symbols.size()));
+  for (const object_symbol& sym : object.symbols) {
+    put_bytes(output, sym.name.data(), sym.name.size());
+    put_u32(output, sym.offset);
+  }
+
+  put_u32(output, static_cast<uint32_t>(object.relocations.size()));
+  for (const object_relocation& rel : object.relocations) {
+    put_u32(output, rel.offset);
+    put_bytes(output, rel.symbol.data(), rel.symbol.size());
+    put_u32(output, static_cast<uint32_t>(rel.line));
+    put_u32(output, static_cast<uint32_t>(rel.pos));
+  }
+
+  put_u32(output, static_cast<uint32_t>(object.includes.size()));
+  for (const object_include& inc : object.includes) {
+    put_bytes(output, inc.name.data(), inc.name.size());
+    put_u32(output, static_cast<uint32_t>(inc.line));
+    put_u32(output, static_cast<uint32_t>(inc.pos));
+  }
+
+  const optimizer_stats& opt = object.optimized;
+  for (std::size_t count : {opt.instructions_before, opt.instructions_after, opt.jumps_threaded,
+         opt.tail_calls, opt.dead_removed, opt.loads_removed})
+    put_u32(output, static_cast<uint32_t>(count));
+}
+
+// reads fields from an encoded object; every read fails once the input runs out
+class object_reader {
+public:
+  object_reader(const uint8_t* data, std::size_t size) : _ptr{data}, _end{data + size} {}
+
+  bool at_end() const { return _ptr == _end; }
+
+  bool u32(uint32_t& v) {
+    if (_end - _ptr < 4)
+      return false;
+    v = 0;
+    for (int i = 0; i < 4; ++i)
+      v |= static_cast<uint32_t>(*_ptr++) << (8 * i);
+    return true;
+  }
+
+  bool i32(int& v) {
+    uint32_t u;
+    if (!u32(u))
+      return false;
+    v = static_cast<int>(u);
+    return true;
+  }
+
+  bool u64(uint64_t& v) {
+    uint32_t lo, hi;
+    if (!u32(lo) || !u32(hi))
+      return false;
+    v = static_cast<uint64_t>(hi) << 32 | lo;
+    return true;
+  }
+
+  template <typename Container>
+  bool bytes(Container& c) {
+    uint32_t size;
+    if (!u32(size) || static_cast<std::size_t>(_end - _ptr) < size)
+      return false;
+    c.assign(_ptr, _ptr + size);
+    _ptr += size;
+    return true;
+  }
+
+  // guards against resizing to a huge count read from a corrupt object; every entry takes at
+  // least 4 bytes
+  bool count(uint32_t& n) { return u32(n) && n <= static_cast<std::size_t>(_end - _ptr) / 4; }
+
+private:
+  const uint8_t* _ptr;
+  const uint8_t* _end;
+};
+
+bool read_object(
+  const uint8_t* data, std::size_t size, uint64_t source_hash, object_file& object) {
+  if (size < sizeof(OBJECT_MAGIC) || std::memcmp(data, OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) != 0)
+    return false;
+
+  object_reader in(data + sizeof(OBJECT_MAGIC), size - sizeof(OBJECT_MAGIC));
+  uint32_t version;
+  uint64_t hash;
+  if (!in.u32(version) || version != OBJECT_VERSION || !in.u64(hash) || hash != source_hash)
+    return false;
+
+  object_file result;
+  if (!in.bytes(result.code))
+    return false;
+
+  uint32_t n;
+  if (!in.count(n))
+    return false;
+  result.symbols.resize(n);
+  for (object_symbol& sym : result.symbols) {
+    if (!in.bytes(sym.name) || !in.u32(sym.offset))
+      return false;
+  }
+
+  if (!in.count(n))
+    return false;
+  result.relocations.resize(n);
+  for (object_relocation& rel : result.relocations) {
+    if (!in.u32(rel.offset) || !in.bytes(rel.symbol) || !in.i32(rel.line) || !in.i32(rel.pos))
+      return false;
+  }
+
+  if (!in.count(n))
+    return false;
+  result.includes.resize(n);
+  for (object_include& inc : result.includes) {
+    if (!in.bytes(inc.name) || !in.i32(inc.line) || !in.i32(inc.pos))
+      return false;
+  }
+
+  optimizer_stats& opt = result.optimized;
+  for (std::size_t* count : {&opt.instructions_before, &opt.instructions_after,
+         &opt.jumps_threaded, &opt.tail_calls, &opt.dead_removed, &opt.loads_removed}) {
+    uint32_t v;
+    if (!in.u32(v))
+      return false;
+    *count = v;
+  }
+
+  if (!in.at_end())
+    return false;
+
+  object = std::move(result);
+  return true;
+}
@@ -13,83 +13,9 @@
 // limitations under the License.
 
 #include "asm/opmeta.hpp"
-#include <algorithm>
+#include <array>
 #include <cassert>
 
-opmetatable::opmetatable() {
-  // clang-format off
-  _meta = {
-    // Core instructions
-    {"cls",   operand_type::none, operand_type::none, operand_type::none, 0x00E0, 0, 0, 0},
-    {"ret",   operand_type::none, operand_type::none, operand_type::none, 0x00EE, 0, 0, 0},
-    {"jmp",   operand_type::addr, operand_type::none, operand_type::none, 0x1000, 0, 0, 0},
-    {"call",  operand_type::addr, operand_type::none, operand_type::none, 0x2000, 0, 0, 0},
-    {"skeq",  operand_type::v,    operand_type::k,    operand_type::none, 0x3000, 8, 0, 0},
-    {"skne",  operand_type::v,    operand_type::k,    operand_type::none, 0x4000, 8, 0, 0},
-    {"skeq",  operand_type::v,    operand_type::v,    operand_type::none, 0x5000, 8, 4, 0},
-    {"ld",    operand_type::v,    operand_type::k,    operand_type::none, 0x6000, 8, 0, 0},
-    {"add",   operand_type::v,    operand_type::k,    operand_type::none, 0x7000, 8, 0, 0},
-    {"ld",    operand_type::v,    operand_type::v,    operand_type::none, 0x8000, 8, 4, 0},
-    {"or",    operand_type::v,    operand_type::v,    operand_type::none, 0x8001, 8, 4, 0},
-    {"and",   operand_type::v,    operand_type::v,    operand_type::none, 0x8002, 8, 4, 0},
-    {"xor",   operand_type::v,    operand_type::v,    operand_type::none, 0x8003, 8, 4, 0},
-    {"add",   operand_type::v,    operand_type::v,    operand_type::none, 0x8004, 8, 4, 0},
-    {"sub",   operand_type::v,    operand_type::v,    operand_type::none, 0x8005, 8, 4, 0},
-    {"shr",   operand_type::v,    operand_type::v,    operand_type::none, 0x8006, 8, 4, 0},
-    {"subn",  operand_type::v,    operand_type::v,    operand_type::none, 0x8007, 8, 4, 0},
-    {"shl",   operand_type::v,    operand_type::v,    operand_type::none, 0x800E, 8, 4, 0},
-    {"skne",  operand_type::v,    operand_type::v,    operand_type::none, 0x9000, 8, 4, 0},
-    {"ld",    operand_type::i,    operand_type::addr, operand_type::none, 0xA000, 0, 0, 0},
-    {"ld",    operand_type::i,    operand_type::k,    operand_type::none, 0xA000, 0, 0, 0},
-    {"jmp0",  operand_type::addr, operand_type::none, operand_type::none, 0xB000, 0, 0, 0},
-    {"rand",  operand_type::v,    operand_type::k,    operand_type::none, 0xC000, 8, 0, 0},
-    {"disp",  operand_type::v,    operand_type::v,    operand_type::k,    0xD000, 8, 4, 0},
-    {"skp",   operand_type::v,    operand_type::none, operand_type::none, 0xE09E, 8, 0, 0},
-    {"sknp",  operand_type::v,    operand_type::none, operand_type::none, 0xE0A1, 8, 0, 0},
-    {"ld",    operand_type::v,    operand_type::dt,   operand_type::none, 0xF007, 8, 0, 0},
-    {"input", operand_type::v,    operand_type::none, operand_type::none, 0xF00A, 8, 0, 0},
-    {"ld",    operand_type::dt,   operand_type::v,    operand_type::none, 0xF015, 0, 8, 0},
-    {"ld",    operand_type::st,   operand_type::v,    operand_type::none, 0xF018, 0, 8, 0},
-    {"add",   operand_type::i,    operand_type::v,    operand_type::none, 0xF01E, 0, 8, 0},
-    {"glyph", operand_type::v,    operand_type::none, operand_type::none, 0xF029, 8, 0, 0},
-    {"bcd",   operand_type::v,    operand_type::none, operand_type::none, 0xF033, 8, 0, 0},
-    {"store", operand_type::v,    operand_type::none, operand_type::none, 0xF055, 8, 0, 0},
-    {"load",  operand_type::v,    operand_type::none, operand_type::none, 0xF065, 8, 0, 0},
-
-    // superchip instructions
-    {"lores", operand_type::none, operand_type::none, operand_type::none, 0x00FE, 0, 0, 0},
-    {"hires", operand_type::none, operand_type::none, operand_type::none, 0x00FF, 0, 0, 0},
-  };
-  // clang-format on
-
-  // needs to be sorted for search algorithms
-  std::sort(_meta.begin(), _meta.end());
-}
-
-const opmeta* opmetatable::find_signature(const opmeta& sig) const {
-  auto lesser = std::lower_bound(std::begin(_meta), std::end(_meta), sig);
-  if (lesser != std::end(_meta) && *lesser == sig) {
-    return &*lesser;
-  } else {
-    return nullptr;
-  }
-}
-
-bool opmetatable::is_mnemonic(std::string_view str) const {
-  return std::find_if(std::begin(_meta), std::end(_meta), [=](const auto& m) {
-    return m.mnemonic == str;
-  }) != std::end(_meta);
-}
-
-std::vector<const opmeta*> opmetatable::get_signatures(std::string_view mnemonic) const {
-  std::vector<const opmeta*> metas;
-  for (const opmeta& m : _meta) {
-    if (m.mnemonic == mnemonic)
-      metas.push_back(&m);
-  }
-  return metas;
-}
-
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
@@ -233,7 +159,7 @@ std::string param_string(const opmeta& m, uint16_t opcode, int operand_num) {
   case operand_type::dt:
     return "dt";
   case operand_type::v: {
-    char buf[4] = {0};
+    char buf[8] = {0};
     snprintf(buf, sizeof(buf), "v%X", extract_param(m, opcode, operand_num));
     return buf;
   }
@@ -250,14 +176,38 @@ std::string param_string(const opmeta& m, uint16_t opcode, int operand_num) {
 
 uint16_t strip_operands(uint16_t opcode) { return opcode & strip_mask(opcode); }
 
-const opmeta* opmetatable::find_opcode(uint16_t opcode) const {
-  opcode = strip_operands(opcode);
-  auto it = std::find_if(std::begin(_meta), std::end(_meta), [=](const auto& m) {
-    return opcode == m.opcode;
-  });
-  if (it != std::end(_meta)) {
-    return &*it;
-  } else {
-    return nullptr;
+// index into opmetas for every possible opcode, or NO_OPCODE if it isn't an instruction
+constexpr uint8_t NO_OPCODE = 0xFF;
+static_assert(opmetatable::SIZE < NO_OPCODE);
+// an entry left out of the initializer would be default constructed and sort first
+static_assert(!opmetas[0].mnemonic.empty(), "opmetatable::SIZE is larger than the table");
+
+constexpr std::array<uint8_t, 0x10000> build_opcode_index(const opmetatable& tbl) {
+  std::array<uint8_t, 0x10000> index{};
+  for (std::size_t opcode = 0; opcode < index.size(); ++opcode) {
+    index[opcode] = NO_OPCODE;
   }
-}
\ No newline at end of file
+
+  // walk backwards so that when several entries share an opcode (ld i, k and ld i, addr) the
+  // first one in sort order wins
+  for (std::size_t n = opmetatable::SIZE; n-- > 0;) {
+    const uint16_t base = tbl[n].opcode;
+    const uint16_t operand_bits = static_cast<uint16_t>(~strip_mask(base));
+    // visit every combination of operand bits, i.e. every submask of operand_bits
+    uint16_t operands = 0;
+    do {
+      index[base | operands] = static_cast<uint8_t>(n);
+      operands = (operands - operand_bits) & operand_bits;
+    } while (operands != 0);
+  }
+
+  return index;
+}
+
+// evaluating this takes a few hundred thousand constexpr steps; see ULTIM8_CXX_FLAGS
+constexpr std::array<uint8_t, 0x10000> OPCODE_INDEX = build_opcode_index(opmetas);
+
+const opmeta* opmetatable::find_opcode(uint16_t opcode) const {
+  const uint8_t index = OPCODE_INDEX[opcode];
+  return index != NO_OPCODE ? &_meta[index] : nullptr;
+}
@@ -0,0 +1,337 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "asm/optimizer.hpp"
+#include <algorithm>
+#include <array>
+
+optimizer_stats& optimizer_stats::operator+=(const optimizer_stats& other) {
+  instructions_before += other.instructions_before;
+  instructions_after += other.instructions_after;
+  jumps_threaded += other.jumps_threaded;
+  tail_calls += other.tail_calls;
+  dead_removed += other.dead_removed;
+  loads_removed += other.loads_removed;
+  return *this;
+}
+
+static const opmeta* const JMP = opmetas.find_signature(
+  opmetas.mnemonic_id("jmp"), operand_type::addr, operand_type::none, operand_type::none);
+
+static bool is(const ir_instruction& instr, std::string_view mnemonic) {
+  return !instr.is_data() && instr.m->mnemonic == mnemonic;
+}
+
+static bool is_skip(const ir_instruction& instr) {
+  return is(instr, "skeq") || is(instr, "skne") || is(instr, "skp") || is(instr, "sknp");
+}
+
+// control never falls through to the next instruction
+static bool ends_flow(const ir_instruction& instr) {
+  return is(instr, "jmp") || is(instr, "jmp0") || is(instr, "ret");
+}
+
+// jmp, call, jmp0 or ld i given an address as a number rather than a label; nothing can be
+// moved when one of these might point past it
+static bool has_numeric_address(const ir_instruction& instr) {
+  if (instr.is_data())
+    return false;
+  const bool addr = instr.m->a == operand_type::addr || instr.m->b == operand_type::addr;
+  const bool ld_i = instr.m->a == operand_type::i && instr.m->b == operand_type::k;
+  return (addr && instr.label_ref.empty()) || ld_i;
+}
+
+// ld vx, k or ld vx, vy
+static bool is_variable_load(const ir_instruction& instr) {
+  return is(instr, "ld") && instr.m->a == operand_type::v &&
+         (instr.m->b == operand_type::k || instr.m->b == operand_type::v);
+}
+
+constexpr uint16_t ALL_VARIABLES = 0xFFFF;
+constexpr uint16_t VF = 1 << 0xF;
+
+// variables an instruction may change; bit n stands for vn
+static uint16_t written_variables(const ir_instruction& instr) {
+  const std::string_view name = instr.m->mnemonic;
+  if (instr.m->a != operand_type::v) {
+    // ld i, ld dt, ld st, add i and instructions without operands; call clobbers everything
+    return name == "call" ? ALL_VARIABLES : 0;
+  }
+  const uint16_t x = static_cast<uint16_t>(1 << instr.a);
+  if (name == "ld" || name == "rand" || name == "input")
+    return x;
+  if (name == "add")
+    return instr.m->b == operand_type::v ? x | VF : x;
+  if (name == "or" || name == "and" || name == "xor" || name == "sub" || name == "shr" ||
+      name == "subn" || name == "shl")
+    return x | VF;
+  if (name == "disp")
+    return VF;
+  if (name == "load")
+    return static_cast<uint16_t>((2 << instr.a) - 1);
+  if (name == "skeq" || name == "skne" || name == "skp" || name == "sknp" || name == "glyph" ||
+      name == "bcd" || name == "store")
+    return 0;
+  return ALL_VARIABLES;
+}
+
+// state for one round of rewrites over the program; instructions are only marked removed until
+// compact() drops them and moves everything after
+class peephole {
+public:
+  peephole(ir_program& program, std::unordered_map<std::string_view, std::size_t>& labels,
+    std::vector<label_fixup>& fixups, optimizer_stats& stats)
+      : _program{program}, _labels{labels}, _fixups{fixups}, _stats{stats} {}
+
+  // returns true if anything changed
+  bool run() {
+    analyze();
+    bool changed = false;
+    changed |= tail_calls();
+    changed |= thread_jumps();
+    // the rewrites above keep every instruction where it is
+    if (!_fixed_layout) {
+      changed |= remove_dead_code();
+      changed |= remove_redundant_loads();
+      compact();
+    }
+    return changed;
+  }
+
+private:
+  std::vector<ir_instruction>& instrs() { return _program.instructions; }
+
+  // index of the instruction at address, or instrs().size() for the end of the program
+  std::size_t index_at(std::size_t address) {
+    return std::lower_bound(instrs().begin(), instrs().end(), address,
+             [](const ir_instruction& instr, std::size_t a) { return instr.address < a; }) -
+           instrs().begin();
+  }
+
+  // index of the instruction a label refers to, or -1 if it isn't defined here
+  std::ptrdiff_t label_index(std::string_view name) {
+    auto it = _labels.find(name);
+    return it == _labels.end() ? -1 : static_cast<std::ptrdiff_t>(index_at(it->second));
+  }
+
+  void analyze() {
+    const std::size_t n = instrs().size();
+    _boundary.assign(n + 1, false);
+    for (const auto& [name, address] : _labels)
+      _boundary[index_at(address)] = true;
+
+    _opaque.assign(n, false);
+    for (const ir_instruction& instr : instrs()) {
+      if (instr.label_ref.empty() || !(is(instr, "jmp0") || is(instr, "ld")))
+        continue;
+      const std::ptrdiff_t first = label_index(instr.label_ref);
+      if (first < 0)
+        continue;
+      for (std::size_t i = first; i < n && (i == static_cast<std::size_t>(first) || !_boundary[i]);
+           ++i)
+        _opaque[i] = true;
+    }
+
+    _fixed_layout = std::any_of(instrs().begin(), instrs().end(), has_numeric_address);
+
+    _removed.assign(n, false);
+  }
+
+  // true if instruction i only runs when the skip before it doesn't
+  bool conditional(std::size_t i) {
+    return i > 0 && !_removed[i - 1] && is_skip(instrs()[i - 1]);
+  }
+
+  bool tail_calls() {
+    bool changed = false;
+    for (std::size_t i = 0; i + 1 < instrs().size(); ++i) {
+      ir_instruction& instr = instrs()[i];
+      if (!_opaque[i] && is(instr, "call") && is(instrs()[i + 1], "ret")) {
+        instr.m = JMP;
+        ++_stats.tail_calls;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  bool thread_jumps() {
+    bool changed = false;
+    const std::size_t n = instrs().size();
+    for (std::size_t i = 0; i < n; ++i) {
+      ir_instruction& instr = instrs()[i];
+      if (_opaque[i] || instr.label_ref.empty() || !(is(instr, "jmp") || is(instr, "call")))
+        continue;
+      // bounded, since jumps can form a cycle
+      std::string_view ref = instr.label_ref;
+      for (std::size_t steps = 0; steps < n; ++steps) {
+        const std::ptrdiff_t t = label_index(ref);
+        if (t < 0 || static_cast<std::size_t>(t) == n || _opaque[t])
+          break;
+        const ir_instruction& target = instrs()[t];
+        if (!is(target, "jmp") || target.label_ref.empty() || target.label_ref == ref)
+          break;
+        ref = target.label_ref;
+      }
+      if (ref != instr.label_ref) {
+        instr.label_ref = ref;
+        ++_stats.jumps_threaded;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  bool remove_dead_code() {
+    bool changed = false;
+    const std::size_t n = instrs().size();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (_removed[i] || _opaque[i] || !ends_flow(instrs()[i]) || conditional(i))
+        continue;
+      // anything up to the next label, data or table can't be reached
+      for (std::size_t j = i + 1;
+           j < n && !_boundary[j] && !_opaque[j] && !instrs()[j].is_data(); ++j) {
+        if (!_removed[j]) {
+          _removed[j] = true;
+          ++_stats.dead_removed;
+          changed = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  bool remove_redundant_loads() {
+    bool changed = false;
+    // value of each variable, or -1 if unknown
+    std::array<int, 16> known;
+    known.fill(-1);
+
+    for (std::size_t i = 0; i < instrs().size(); ++i) {
+      if (_boundary[i])
+        known.fill(-1);
+      const ir_instruction& instr = instrs()[i];
+      if (_removed[i])
+        continue;
+      if (_opaque[i] || instr.is_data()) {
+        known.fill(-1);
+        continue;
+      }
+
+      if (is_variable_load(instr)) {
+        const int value = instr.m->b == operand_type::k ? instr.b : known[instr.b];
+        int& x = known[instr.a];
+        // the instruction following a skip can't be removed without changing what is skipped
+        if (conditional(i)) {
+          x = x == value ? value : -1;
+        } else if (value >= 0 && x == value) {
+          _removed[i] = true;
+          ++_stats.loads_removed;
+          changed = true;
+        } else {
+          x = value;
+        }
+        continue;
+      }
+
+      const uint16_t written = written_variables(instr);
+      for (std::size_t v = 0; v < known.size(); ++v) {
+        if (written & (1 << v))
+          known[v] = -1;
+      }
+    }
+    return changed;
+  }
+
+  // drops removed instructions and moves everything after them, along with labels and fixups
+  void compact() {
+    std::vector<ir_instruction>& old = instrs();
+    const std::size_t n = old.size();
+    if (n == 0)
+      return;
+
+    std::vector<std::size_t> old_addresses(n);
+    for (std::size_t i = 0; i < n; ++i)
+      old_addresses[i] = old[i].address;
+
+    // new index of each old instruction; removed instructions map to the next one kept
+    std::vector<std::size_t> new_index(n + 1);
+    std::size_t address = old.front().address;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      new_index[i] = kept;
+      if (_removed[i])
+        continue;
+      old[kept] = old[i];
+      old[kept].address = address;
+      address += old[kept].size();
+      ++kept;
+    }
+    new_index[n] = kept;
+    old.resize(kept);
+    const std::size_t end_address = address;
+
+    for (auto& [name, label_address] : _labels) {
+      const std::size_t i =
+        std::lower_bound(old_addresses.begin(), old_addresses.end(), label_address) -
+        old_addresses.begin();
+      const std::size_t k = new_index[i];
+      label_address = k < kept ? old[k].address : end_address;
+    }
+
+    std::vector<label_fixup> fixups;
+    fixups.reserve(_fixups.size());
+    for (label_fixup f : _fixups) {
+      if (_removed[f.instr_index])
+        continue;
+      f.instr_index = new_index[f.instr_index];
+      fixups.push_back(f);
+    }
+    _fixups = std::move(fixups);
+  }
+
+  ir_program& _program;
+  std::unordered_map<std::string_view, std::size_t>& _labels;
+  std::vector<label_fixup>& _fixups;
+  optimizer_stats& _stats;
+
+  // _boundary[i]: a label refers to instruction i; has an extra entry for the end
+  std::vector<bool> _boundary;
+  // _opaque[i]: instruction i is part of a jump table or data; it's never changed
+  std::vector<bool> _opaque;
+  std::vector<bool> _removed;
+  // set if an instruction refers to a numeric address; no instruction is removed then
+  bool _fixed_layout = false;
+};
+
+static std::size_t count_instructions(const ir_program& program) {
+  return std::count_if(program.instructions.begin(), program.instructions.end(),
+    [](const ir_instruction& instr) { return !instr.is_data(); });
+}
+
+optimizer_stats optimize(ir_program& program,
+  std::unordered_map<std::string_view, std::size_t>& labels, std::vector<label_fixup>& fixups) {
+  optimizer_stats stats;
+  stats.instructions_before = count_instructions(program);
+
+  // each rewrite can expose more for the others, e.g. a tail call leaves a dead ret behind
+  peephole p(program, labels, fixups, stats);
+  for (int round = 0; round < 8; ++round) {
+    if (!p.run())
+      break;
+  }
+
+  stats.instructions_after = count_instructions(program);
+  return stats;
+}
@@ -14,9 +14,24 @@
 
 #include "asm/parser.hpp"
 #include "asm/lexer.hpp"
-#include <algorithm>
+#include "asm/optimizer.hpp"
+#include <array>
 #include <cassert>
 
+constexpr bool is_operand(token_type t) {
+  switch (t) {
+  case token_type::variable:
+  case token_type::number:
+  case token_type::text:
+  case token_type::i:
+  case token_type::dt:
+  case token_type::st:
+    return true;
+  default:
+    return false;
+  }
+}
+
 constexpr operand_type token_to_operand_type(token_type t) {
   switch (t) {
   case token_type::variable:
@@ -37,34 +52,42 @@ constexpr operand_type token_to_operand_type(token_type t) {
   }
 }
 
-parser::parser(lexer& lex) : _lex{ lex } {
+parser::parser(lexer& lex, std::size_t address) : _lex{ lex }, _address{ address } {
   _lex.next();
 }
 
-std::vector<ir_instruction> parser::parse_instructions() {
-  while (current().type != token_type::eos) {
-    parse_top_level();
+ir_program parser::parse_program() {
+  while (!at_end()) {
+    parse_statement();
+  }
+
+  // includes are resolved by the module build, which needs to know where the source came from
+  if (!_program.includes.empty()) {
+    const module_include& inc = _program.includes.front();
+    throw syntax_error("include is only supported when assembling files", inc.line, inc.pos,
+      std::string(inc.name));
   }
 
   resolve_labels();
 
-  return std::move(_instructions);
+  return std::move(_program);
 }
 
 void parser::resolve_labels() {
-  for (auto& instr : _instructions) {
-    if (instr.label_ref.size()) {
-      auto it = std::find_if(
-        _labels.begin(), _labels.end(), [&](const auto& l) { return l.name == instr.label_ref; });
-      if (it != _labels.end()) {
-        if (instr.m->a == operand_type::addr)
-          instr.a = static_cast<int>(_instructions[it->instr_index].address);
-        if (instr.m->b == operand_type::addr)
-          instr.b = static_cast<int>(_instructions[it->instr_index].address);
-        if (instr.m->c == operand_type::addr)
-          instr.c = static_cast<int>(_instructions[it->instr_index].address);
-      }
+  for (const label_fixup& fixup : _fixups) {
+    ir_instruction& instr = _program.instructions[fixup.instr_index];
+    auto it = _labels.find(instr.label_ref);
+    if (it == _labels.end()) {
+      throw syntax_error(
+        "undefined label", fixup.line, fixup.pos, std::string(instr.label_ref));
     }
+    const int address = static_cast<int>(it->second);
+    if (instr.m->a == operand_type::addr)
+      instr.a = address;
+    if (instr.m->b == operand_type::addr)
+      instr.b = address;
+    if (instr.m->c == operand_type::addr)
+      instr.c = address;
   }
 }
 
@@ -72,33 +95,42 @@ void parser::parse_data() {
   _lex.next();
 
   ir_instruction data_pinstr;
+  data_pinstr.data_offset = static_cast<uint32_t>(_program.data.size());
 
   while (next().type == token_type::comma) {
     if (current().type != token_type::number)
       error("expected number", current());
-    data_pinstr.parameters.push_back(current().numeric_value);
+    _program.data.push_back(static_cast<uint8_t>(current().numeric_value));
     _lex.next();
     _lex.next();
   }
   if (current().type != token_type::number)
     error("expected number", current());
-  data_pinstr.parameters.push_back(current().numeric_value);
+  _program.data.push_back(static_cast<uint8_t>(current().numeric_value));
   _lex.next();
+
+  data_pinstr.data_size = static_cast<uint32_t>(_program.data.size()) - data_pinstr.data_offset;
   add_instruction(data_pinstr);
 }
 
+void parser::parse_include() {
+  _lex.next();
+  if (current().type != token_type::text)
+    error("expected module name", current());
+  _program.includes.push_back({current().span, current().location.line, current().location.pos});
+  _lex.next();
+}
+
 void parser::parse_instruction() {
   token mnemonic_tok = current();
   auto instr_name = mnemonic_tok.span;
 
+  const int mnemonic = mnemonic_tok.mnemonic;
+
   // first, see if this instruction has a version that doesn't take parameters
   {
-    opmeta m;
-    m.mnemonic = instr_name;
-    m.a = operand_type::none;
-    m.b = operand_type::none;
-    m.c = operand_type::none;
-    if (const auto* it = _omtbl.find_signature(m)) {
+    constexpr operand_type none = operand_type::none;
+    if (const auto* it = opmetas.find_signature(mnemonic, none, none, none)) {
       add_instruction(ir_instruction{it, 0, 0, 0});
       _lex.next();
       return;
@@ -107,55 +139,62 @@ void parser::parse_instruction() {
 
   // if it doesn't, gather the parameters and try to infer the correct version
   _lex.next();
-  std::vector<token> parameters;
-  while (next().type == token_type::comma) {
+  std::array<token, 3> parameters;
+  std::size_t parameter_count = 0;
+  const auto push_parameter = [&]() {
     if (current().type == token_type::eos)
       error("unexpected end of file", current());
-    parameters.push_back(current());
+    if (parameter_count == parameters.size())
+      error("too many operands", mnemonic_tok);
+    if (!is_operand(current().type))
+      error("expected operand", current());
+    parameters[parameter_count++] = current();
+  };
+  while (next().type == token_type::comma) {
+    push_parameter();
     _lex.next();
     _lex.next();
   }
-  if (current().type == token_type::eos)
-    error("unexpected end of file", current());
-  parameters.push_back(current());
+  push_parameter();
   _lex.next();
 
-  if (parameters.size() > 3) {
-    error("too many operands", mnemonic_tok);
-  }
-
   // build an opmeta from the parameters to perform a lookup
   opmeta om;
   om.mnemonic = instr_name;
-  if (parameters.size() > 0)
+  if (parameter_count > 0)
     om.a = token_to_operand_type(parameters[0].type);
-  if (parameters.size() > 1)
+  if (parameter_count > 1)
     om.b = token_to_operand_type(parameters[1].type);
-  if (parameters.size() > 2)
+  if (parameter_count > 2)
     om.c = token_to_operand_type(parameters[2].type);
 
-  if (const opmeta* m = _omtbl.find_signature(om); m) {
+  if (const opmeta* m = opmetas.find_signature(mnemonic, om.a, om.b, om.c); m) {
     int a = om.parameter_count() > 0 ? parameters[0].numeric_value : 0;
     int b = om.parameter_count() > 1 ? parameters[1].numeric_value : 0;
     int c = om.parameter_count() > 2 ? parameters[2].numeric_value : 0;
 
     ir_instruction instr{m, a, b, c};
 
+    const token* ref = nullptr;
     if (om.a == operand_type::addr) {
-      instr.label_ref = parameters[0].span;
+      ref = &parameters[0];
     }
     if (om.b == operand_type::addr) {
-      instr.label_ref = parameters[1].span;
+      ref = &parameters[1];
+    }
+    if (ref) {
+      instr.label_ref = ref->span;
+      _fixups.push_back({_program.instructions.size(), ref->location.line, ref->location.pos});
     }
 
     add_instruction(instr);
   } else {
     std::string help = "instruction forms:\n\n";
-    for (const auto& m : _omtbl.get_signatures(instr_name)) {
+    for (const opmeta& m : opmetas.get_signatures(mnemonic)) {
       help += "  ";
-      help += std::string(m->mnemonic) + " ";
-      for (int i = 0; i < m->parameter_count(); ++i) {
-        help += to_string(m->parameter(i));
+      help += std::string(m.mnemonic) + " ";
+      for (int i = 0; i < m.parameter_count(); ++i) {
+        help += to_string(m.parameter(i));
         help += ", ";
       }
       help.pop_back();
@@ -166,24 +205,41 @@ void parser::parse_instruction() {
   }
 }
 
-void parser::parse_top_level() {
+optimizer_stats parser::optimize() {
+  assert(at_end());
+  return ::optimize(_program, _labels, _fixups);
+}
+
+bool parser::at_end() {
+  return current().type == token_type::eos;
+}
+
+statement_type parser::parse_statement() {
   if (current().type == token_type::text) {
     if (next().type == token_type::colon) {
       parse_label();
+      return statement_type::label;
     } else if (current().span == "data") {
       parse_data();
+      return statement_type::data;
+    } else if (current().span == "include") {
+      parse_include();
+      return statement_type::include;
     } else {
       error("expected ':' after label", _lex.current());
     }
   } else if (current().type == token_type::mnemonic) {
     parse_instruction();
+    return statement_type::instruction;
   } else {
     error("expected label, data, or mnemonic", _lex.current());
   }
 }
 
 void parser::parse_label() {
-  _labels.push_back({current().span, _instructions.size()});
+  if (!_labels.try_emplace(current().span, _address).second) {
+    error("duplicate label", current());
+  }
   _lex.next();
   _lex.next();
 }
@@ -197,9 +253,9 @@ const token& parser::next() {
 }
 
 void parser::add_instruction(ir_instruction i) {
-  _instructions.push_back(std::move(i));
-  _instructions.back().address = _address;
-  _address += _instructions.back().size();
+  i.address = _address;
+  _address += i.size();
+  _program.instructions.push_back(i);
 }
 
 void parser::error(const char* msg, const token& t) {
@@ -210,28 +266,34 @@ void parser::error(const char* msg, const token& t, std::string help) {
   throw syntax_error(msg, t.location.line, t.location.pos, std::string(t.span), std::move(help));
 }
 
-#include "common/eswap.hpp"
+#include <algorithm>
 #include <iostream>
 
 uint16_t encode_instruction(const ir_instruction& instr) {
   return generate_op(*instr.m, instr.a, instr.b, instr.c);
 }
 
-void write_instruction(std::ostream& output, const ir_instruction& instr) {
-  if (!instr.is_data()) {
-    uint16_t bytes = eswap(encode_instruction(instr));
-    output.write(reinterpret_cast<const char*>(&bytes), sizeof(uint16_t));
-  } else {
-    output.write(reinterpret_cast<const char*>(instr.parameters.data()), instr.parameters.size());
+void write_program(uint8_t* output, const ir_program& program) {
+  for (const ir_instruction& instr : program.instructions) {
+    if (!instr.is_data()) {
+      uint16_t bytes = encode_instruction(instr);
+      *output++ = (bytes & 0xFF00) >> 8;
+      *output++ = (bytes & 0x00FF) >> 0;
+    } else {
+      output = std::copy_n(program.payload(instr), instr.data_size, output);
+    }
   }
 }
 
-void write_instruction(std::vector<uint8_t>& output, const ir_instruction& instr) {
-  if (!instr.is_data()) {
-    uint16_t bytes = encode_instruction(instr);
-    output.push_back((bytes & 0xFF00) >> 8);
-    output.push_back((bytes & 0x00FF) >> 0);
-  } else {
-    output.insert(output.end(), instr.parameters.begin(), instr.parameters.end());
-  }
-}
\ No newline at end of file
+void write_program(std::ostream& output, const ir_program& program) {
+  // assemble everything first so the stream sees a single write
+  std::vector<uint8_t> bytes;
+  write_program(bytes, program);
+  output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void write_program(std::vector<uint8_t>& output, const ir_program& program) {
+  const std::size_t offset = output.size();
+  output.resize(offset + program.size());
+  write_program(output.data() + offset, program);
+}
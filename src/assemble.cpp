@@ -12,54 +12,86 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <fmt/format.h>
 
-#include "asm/lexer.hpp"
-#include "asm/parser.hpp"
+#include "asm/error.hpp"
+#include "asm/module.hpp"
 
-std::string read_file(const char* filename) {
-  std::ifstream file(filename, std::ios::binary);
-
-  file.seekg(0, std::ios::end);
-  std::streampos length = file.tellg();
-  file.seekg(0);
-
-  std::string text;
-  text.resize(length);
-
-  file.read(text.data(), length);
-  return text;
+static void print_usage(const char* program) {
+  fmt::print("usage: {} [-O] [--cache <dir>] [-j <threads>] <input file> <output file>\n\n"
+             "  -O             optimize the program to run fewer instructions\n"
+             "  --cache <dir>  keep assembled modules in dir and reuse them while unchanged\n"
+             "  -j <threads>   number of modules to assemble at once (default: one per core)\n",
+    program);
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 3) {
-    fmt::print("usage: {} <input file> <output file>", argv[0]);
-    return EXIT_FAILURE;
-  }
-
-  const char* input_filename = argv[1];
-  const char* output_filename = argv[2];
+  module_options options;
+  const char* input_filename = nullptr;
+  const char* output_filename = nullptr;
 
-  std::string source = read_file(input_filename);
-  std::ofstream output(output_filename, std::ios::binary);
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-O") == 0) {
+      options.optimize = true;
+    } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      options.cache_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (!input_filename) {
+      input_filename = argv[i];
+    } else if (!output_filename) {
+      output_filename = argv[i];
+    } else {
+      input_filename = nullptr;
+      break;
+    }
+  }
 
-  lexer lex(std::move(source));
-  parser p(lex);
+  if (!input_filename || !output_filename) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
 
+  std::vector<uint8_t> program;
+  module_stats stats;
   try {
-    for (const auto& instr : p.parse_instructions()) {
-      write_instruction(output, instr);
-    }
+    program = assemble_modules(input_filename, options, &stats);
   } catch (const syntax_error& e) {
     if (e.has_help()) {
-      fmt::print("syntax error at {}:{} near `{}': {}\n\n{}", e.line, e.pos, e.context, e.what(), e.help);
+      fmt::print("{}:{}:{}: syntax error near `{}': {}\n\n{}", e.file, e.line, e.pos, e.context,
+        e.what(), e.help);
+    } else {
+      fmt::print("{}:{}:{}: syntax error near `{}': {}", e.file, e.line, e.pos, e.context,
+        e.what());
+    }
+    return EXIT_FAILURE;
+  } catch (const link_error& e) {
+    if (e.line) {
+      fmt::print("{}:{}:{}: {} `{}'", e.file, e.line, e.pos, e.what(), e.symbol);
     } else {
-      fmt::print("syntax error at {}:{} near `{}': {}", e.line, e.pos, e.context, e.what());
+      fmt::print("{}: {} `{}'", e.file, e.what(), e.symbol);
     }
     return EXIT_FAILURE;
+  } catch (const std::exception& e) {
+    fmt::print("{}", e.what());
+    return EXIT_FAILURE;
   }
 
+  if (options.optimize) {
+    const optimizer_stats& opt = stats.optimized;
+    fmt::print("optimized {} of {} instructions away: {} jumps threaded, {} tail calls, "
+               "{} dead instructions, {} redundant loads\n",
+      opt.removed(), opt.instructions_before, opt.jumps_threaded, opt.tail_calls,
+      opt.dead_removed, opt.loads_removed);
+  }
+
+  // only create the output once the program assembled
+  std::ofstream output(output_filename, std::ios::binary);
+  output.write(reinterpret_cast<const char*>(program.data()), program.size());
+
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
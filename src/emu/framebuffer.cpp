@@ -13,27 +13,68 @@
 // limitations under the License.
 
 #include "emu/framebuffer.hpp"
+#include <algorithm>
 #include <cstring>
 
-framebuffer::framebuffer() : _width{0}, _height{0} {
+inline std::size_t stride_for(std::size_t width) {
+  return (width + 7) / 8;
+}
+
+framebuffer::framebuffer() : _width{0}, _height{0}, _stride{0} {
 }
 
 framebuffer::framebuffer(std::size_t width, std::size_t height)
-    : _width{width}, _height{height}, _pixels(_width * _height, 0) {
+    : _width{width},
+      _height{height},
+      _stride{stride_for(width)},
+      _pixels(_stride * _height, 0),
+      _row_generation(_height, 0) {
 }
 
 void framebuffer::clear() {
   std::memset(_pixels.data(), 0, _pixels.size());
+  touch_all();
 }
 
 bool framebuffer::toggle(int x, int y) {
   wrap(x, y);
-  return _pixels[y * _width + x] ^= 255;
+  _row_generation[y] = ++_generation;
+  const uint8_t mask = 0x80 >> (x % 8);
+  uint8_t& bits = _pixels[y * _stride + x / 8];
+  bits ^= mask;
+  return bits & mask;
+}
+
+void framebuffer::resize(std::size_t width, std::size_t height) {
+  _width = width;
+  _height = height;
+  _stride = stride_for(width);
+  _pixels.assign(_stride * _height, 0);
+  _row_generation.resize(_height);
+  touch_all();
+}
+
+framebuffer::row_span framebuffer::changed_since(uint64_t generation) const {
+  row_span span{0, 0};
+  if (generation >= _generation)
+    return span;
+
+  while (span.first < _height && _row_generation[span.first] <= generation)
+    ++span.first;
+  span.last = _height;
+  while (span.last > span.first && _row_generation[span.last - 1] <= generation)
+    --span.last;
+  return span;
+}
+
+void framebuffer::touch_all(uint64_t after) {
+  _generation = std::max(_generation, after) + 1;
+  std::fill(_row_generation.begin(), _row_generation.end(), _generation);
 }
 
 bool framebuffer::is_on(int x, int y) const {
   wrap(x, y);
-  return _pixels[y * _width + x];
+  return _pixels[y * _stride + x / 8] & (0x80 >> (x % 8));
 }
 
 inline void framebuffer::wrap(int& x, int& y) const {
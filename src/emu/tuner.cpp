@@ -0,0 +1,90 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "emu/tuner.hpp"
+#include "emu/vm.hpp"
+#include <algorithm>
+
+cycle_tuner::cycle_tuner(int frames_to_observe) : _frames_to_observe{frames_to_observe} {
+}
+
+void cycle_tuner::observe(const chip8vm& vm) {
+  if (finished()) {
+    return;
+  }
+
+  if (_idle) {
+    ++_cycle;
+    return;
+  }
+
+  const int pc = vm.pc;
+  const uint16_t opcode = (vm.memory[pc] << 8) | vm.memory[pc + 1];
+
+  if (_cycle > 0 && pc == _last_pc) {
+    // no progress since the last instruction: jump to self, blocking input, or a fault
+    _idle = true;
+  } else if ((opcode & 0xF0FF) == 0xF007) {
+    // ld vx, dt; dt can't change until the next tick, so reading it again from the same place
+    // means the rom is waiting for it
+    if (pc == _dt_poll_pc) {
+      _idle = true;
+    } else {
+      _dt_poll_pc = pc;
+    }
+  } else if ((opcode & 0xF0FF) == 0xF015) {
+    // ld dt, vx; the rom changed dt itself so the next read is meaningful
+    _dt_poll_pc = -1;
+  }
+
+  if (_idle) {
+    _busy = _cycle;
+  }
+
+  _last_pc = pc;
+  ++_cycle;
+}
+
+void cycle_tuner::end_frame(bool display_wait) {
+  if (finished() || _cycle == 0) {
+    return;
+  }
+
+  if (display_wait && !_idle) {
+    // the rom would have spent the rest of the frame waiting for vblank
+    _idle = true;
+    _busy = _cycle;
+  }
+
+  if (_idle) {
+    _max_busy = std::max(_max_busy, _busy);
+  } else {
+    _saturated = true;
+  }
+  ++_frames;
+
+  _cycle = 0;
+  _busy = 0;
+  _idle = false;
+  _last_pc = -1;
+  _dt_poll_pc = -1;
+}
+
+std::optional<int> cycle_tuner::recommendation() const {
+  if (_saturated || _frames == 0) {
+    return std::nullopt;
+  }
+  // leave headroom for frames that weren't observed, e.g. ones doing extra work on input
+  return _max_busy + _max_busy / 4 + 1;
+}
@@ -54,7 +54,7 @@ uint8_t bigfont_data[] = {
 };
 // clang-format on
 
-chip8vm::chip8vm() : rng(rd()), byte_dist(0, 255) {
+chip8vm::chip8vm() : rng(std::random_device{}()), byte_dist(0, 255) {
   copy_font_glyphs();
 }
 
@@ -217,12 +217,12 @@ inline void chip8vm::ret() {
 
 // 0x00FF
 inline void chip8vm::hires() {
-  framebuf = framebuffer{128, 64};
+  framebuf.resize(128, 64);
 }
 
 // 0x00FE
 inline void chip8vm::lores() {
-  framebuf = framebuffer{64, 32};
+  framebuf.resize(64, 32);
 }
 
 // 0x00FD
@@ -382,6 +382,9 @@ inline void chip8vm::disp(variable a, variable b, uint8_t c) {
   int y = variables[b];
   int h = c;
   draw_sprite(x, y, h);
+  if (cflags & compat_flags::display_wait) {
+    vblank_wait = true;
+  }
 }
 
 // 0xE09E
@@ -14,7 +14,10 @@
 
 #include "frontend/application.hpp"
 #include "asm/compiler.hpp"
+#include "asm/incremental.hpp"
+#include "asm/module.hpp"
 #include "frontend/renderer.hpp"
+#include "frontend/debugger.hpp"
 #include "frontend/romio.hpp"
 #include "asm/lexer.hpp"
 #include "asm/parser.hpp"
@@ -22,57 +25,11 @@
 #include "frontend/config.hpp"
 #include <fmt/format.h>
 #include <gl/gl3w.h>
+#include <algorithm>
 #include <map>
 
 #include <filesystem>
 
-bool get_event_window_id(const SDL_Event& ev, Uint32& id) {
-  // not a comprehensive list
-  switch (ev.type) {
-  case SDL_MOUSEWHEEL:
-    id = ev.wheel.windowID;
-    return true;
-  case SDL_MOUSEBUTTONDOWN:
-    id = ev.button.windowID;
-    return true;
-  case SDL_TEXTINPUT:
-    id = ev.text.windowID;
-    return true;
-  case SDL_KEYDOWN:
-  case SDL_KEYUP:
-    id = ev.key.windowID;
-    return true;
-  case SDL_WINDOWEVENT:
-    id = ev.window.windowID;
-    return true;
-  case SDL_DROPFILE:
-    id = ev.drop.windowID;
-    return true;
-  default:
-    return false;
-  }
-}
-
-bool is_event_for(const SDL_Event& ev, Uint32 id) {
-  if (Uint32 dest_id; get_event_window_id(ev, dest_id)) {
-    return dest_id == id;
-  } else {
-    return false;
-  }
-}
-
-void align_to_right(SDL_Window* to, SDL_Window* alignee) {
-  int window_x;
-  int window_y;
-  int window_width;
-  int left_border;
-  int right_border;
-  SDL_GetWindowSize(to, &window_width, nullptr);
-  SDL_GetWindowPosition(to, &window_x, &window_y);
-  SDL_GetWindowBordersSize(to, nullptr, &left_border, nullptr, &right_border);
-  SDL_SetWindowPosition(alignee, window_x + window_width + left_border + right_border, window_y);
-}
-
 inline bool map_sdl_key(const std::map<SDL_Keycode, chip8_key>& keymap, SDL_Keycode code, chip8_key& keyvalue) {
   if (auto it = keymap.find(code); it != keymap.end()) {
     keyvalue = it->second;
@@ -108,6 +65,33 @@ std::vector<uint8_t> compile_demo() {
   return compile(source);
 }
 
+std::string format_syntax_error(const syntax_error& e) {
+  // errors from included modules say which file they are in
+  const std::string file = e.file.empty() ? "" : e.file + ":";
+  if (e.has_help()) {
+    return fmt::format("syntax error at {}{}:{} near `{}': {}\n\n{}", file, e.line, e.pos,
+      e.context, e.what(), e.help);
+  } else {
+    return fmt::format(
+      "syntax error at {}{}:{} near `{}': {}", file, e.line, e.pos, e.context, e.what());
+  }
+}
+
+std::string format_link_error(const link_error& e) {
+  if (e.line) {
+    return fmt::format("{} `{}' at {}:{}:{}", e.what(), e.symbol, e.file, e.line, e.pos);
+  } else {
+    return fmt::format("{} `{}' in {}", e.what(), e.symbol, e.file);
+  }
+}
+
+// converts an SDL event timestamp to the clock used by the emulation thread
+emulator::time_point event_time(Uint32 timestamp) {
+  // SDL_GetTicks() wraps after ~49 days; unsigned subtraction handles that
+  const Uint32 age_ms = SDL_GetTicks() - timestamp;
+  return emulator::clock::now() - std::chrono::milliseconds{age_ms};
+}
+
 void application::handle_quit(const SDL_QuitEvent& ev) {
   running = false;
 }
@@ -117,39 +101,37 @@ void application::handle_window_event(const SDL_WindowEvent& ev) {
     running = false;
   } else if (ev.event == SDL_WINDOWEVENT_RESIZED) {
     update_viewport();
+  } else if (ev.event == SDL_WINDOWEVENT_EXPOSED) {
+    render->invalidate();
   }
 }
 
 void application::handle_key_down(const SDL_KeyboardEvent& ev) {
-  if (chip8_key k; map_sdl_key(cfg.input.kmap, ev.keysym.sym, k)) {
-    chip8->inp.set_key_state(k, true);
+  if (chip8_key k; map_sdl_key(kmap, ev.keysym.sym, k)) {
+    emu->post({emu_command::type::key_down, k, event_time(ev.timestamp)});
   }
   if (ev.keysym.sym == SDLK_g) {
-    paused = !paused;
-    debug->notify_pause_state(paused);
+    toggle_pause();
   }
   if (ev.keysym.sym == SDLK_h) {
-    chip8->step();
+    emu->post({emu_command::type::step});
   }
   if (ev.keysym.sym == cfg.input.reload && filename) {
-    load_file(filename->c_str());
+    reload_file();
   }
   if (ev.keysym.sym == cfg.input.toggle_debugger) {
-    debug->toggle_visibility();
-    // keep focus on this window
-    SDL_RaiseWindow(window);
+    set_debugger_visible(!debugger_visible());
   }
   if (ev.keysym.sym == cfg.input.increase_cycles) {
-    const int amt = ev.keysym.mod & KMOD_LCTRL ? 10000 : 1000;
-    cpu_freq.hz(cpu_freq.hz() + amt);
-    update_title();
+    const int amt = ev.keysym.mod & KMOD_LCTRL ? 100 : 10;
+    set_cycles_per_frame(cycles_per_frame + amt);
   }
   if (ev.keysym.sym == cfg.input.decrease_cycles) {
-    const int amt = ev.keysym.mod & KMOD_LCTRL ? 10000 : 1000;
-    cpu_freq.hz(cpu_freq.hz() - amt);
-    if (cpu_freq.hz() < 1000)
-      cpu_freq.hz(1000);
-    update_title();
+    const int amt = ev.keysym.mod & KMOD_LCTRL ? 100 : 10;
+    set_cycles_per_frame(std::max(cycles_per_frame - amt, 1));
+  }
+  if (ev.keysym.sym == cfg.input.fast_forward && !ev.repeat) {
+    set_fast_forward(true);
   }
   if (ev.keysym.sym == SDLK_RETURN && ev.keysym.mod & KMOD_LCTRL) {
     toggle_fullscreen();
@@ -158,8 +140,11 @@ void application::handle_key_down(const SDL_KeyboardEvent& ev) {
 
 void application::handle_key_up(const SDL_KeyboardEvent& ev) {
   chip8_key input;
-  if (map_sdl_key(cfg.input.kmap, ev.keysym.sym, input)) {
-    chip8->inp.set_key_state(input, false);
+  if (map_sdl_key(kmap, ev.keysym.sym, input)) {
+    emu->post({emu_command::type::key_up, input, event_time(ev.timestamp)});
+  }
+  if (ev.keysym.sym == cfg.input.fast_forward) {
+    set_fast_forward(false);
   }
 }
 
@@ -168,33 +153,44 @@ void application::handle_drop_file(const SDL_DropEvent& ev) {
   SDL_free(ev.file);
 }
 
-void application::handle_events() {
+void application::handle_events(int timeout_ms) {
   SDL_Event ev;
-  
-  while (running && SDL_PollEvent(&ev)) {
-    // dispatch events to debug window and skip them on the main window
-    if (is_event_for(ev, debug->window_id())) {
-      debug->process_event(ev);
-      continue;
-    }
 
-    switch (ev.type) {
-    case SDL_QUIT:
-      handle_quit(ev.quit);
-      break;
-    case SDL_WINDOWEVENT:
-      handle_window_event(ev.window);
-      break;
-    case SDL_KEYDOWN:
-      handle_key_down(ev.key);
-      break;
-    case SDL_KEYUP:
-      handle_key_up(ev.key);
-      break;
-    case SDL_DROPFILE:
-      handle_drop_file(ev.drop);
-      break;
-    }
+  // when there is nothing to emulate, sleep until something happens instead of spinning
+  bool have_event = timeout_ms > 0 ? SDL_WaitEventTimeout(&ev, timeout_ms) : SDL_PollEvent(&ev);
+
+  while (running && have_event) {
+    handle_event(ev);
+    have_event = SDL_PollEvent(&ev);
+  }
+}
+
+void application::handle_event(const SDL_Event& ev) {
+  if (run_main_thread_call(ev)) {
+    return;
+  }
+
+  // events the debugger panel wants aren't meant for the emulator
+  if (debugger_visible() && debug->process_event(ev)) {
+    return;
+  }
+
+  switch (ev.type) {
+  case SDL_QUIT:
+    handle_quit(ev.quit);
+    break;
+  case SDL_WINDOWEVENT:
+    handle_window_event(ev.window);
+    break;
+  case SDL_KEYDOWN:
+    handle_key_down(ev.key);
+    break;
+  case SDL_KEYUP:
+    handle_key_up(ev.key);
+    break;
+  case SDL_DROPFILE:
+    handle_drop_file(ev.drop);
+    break;
   }
 }
 
@@ -214,30 +210,45 @@ application::application(int argc, char* argv[]) {
 
   gl3wInit();
 
+  pacer.set_vsync(cfg.display.vsync);
+  if (SDL_DisplayMode mode; SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0) {
+    pacer.set_refresh_rate(mode.refresh_rate);
+  }
+
   render = std::make_unique<renderer>();
   render->set_background_color(cfg.display.render_background);
   render->set_foreground_color(cfg.display.render_foreground);
 
   window_id = SDL_GetWindowID(window);
-  chip8 = std::make_unique<chip8vm>();
   audio = std::make_unique<audio_context>(cfg.audio.frequency, cfg.audio.samples);
-  debug = std::make_unique<debugger>();
-  debug->set_state(chip8.get());
-  debug->on_click_pause = [this]() {
-    paused = !paused;
-    debug->notify_pause_state(paused);
-  };
-  debug->on_click_step = [this]() { chip8->step(); };
+  emu = std::make_unique<emulator>(*audio, cycles_per_frame, cfg.latency, cfg.fast_forward);
+  jobs = std::make_unique<worker>();
+  if (cfg.watch.enabled) {
+    // called on the watcher's thread
+    watcher = std::make_unique<file_watcher>(
+      std::chrono::milliseconds{cfg.watch.debounce_ms}, [this](const std::string& path) {
+        call_on_main_thread([this, path]() { file_changed(path); });
+      });
+    update_watched_files();
+  }
+  // the debugger is only created once it is first shown
   if (cfg.debug.visible) {
-    debug->show();
+    set_debugger_visible(true);
   }
-
-  align_to_right(window, debug->window());
+  update_viewport();
 
   handle_command_line(argc, argv);
 }
 
 application::~application() {
+  // background threads call back into this
+  watcher.reset();
+  jobs.reset();
+  // the emulation thread uses the audio device, so it has to stop first
+  emu.reset();
+  // these release gl objects, which needs the context
+  debug.reset();
+  render.reset();
   if (window)
     SDL_DestroyWindow(window);
   if (gl)
@@ -249,109 +260,364 @@ void application::handle_command_line(int argc, char* argv[]) {
     load_file(argv[1]);
   } else {
     auto demo_bytes = compile_demo();
-    load_rom_from_memory(*chip8, demo_bytes.data(), demo_bytes.size());
+    auto demo = std::make_unique<chip8vm>();
+    load_rom_from_memory(*demo, demo_bytes.data(), demo_bytes.size());
+    emu_command cmd{emu_command::type::load};
+    cmd.vm = std::move(demo);
+    emu->post(std::move(cmd));
     update_title();
   }
 }
 
 void application::run() {
-  time_point last = clock::now();
+  // how long to block waiting for events while paused or halted; the debugger still gets
+  // updated this often
+  const int IDLE_WAIT_MS = 100;
 
-  duration timer_acc = duration{0};
-  duration cpu_acc = duration{0};
+  emu->start();
+
+  while (running) {
+    const bool idle = is_idle();
+    handle_events(idle ? IDLE_WAIT_MS : 0);
 
-  const duration profile_delay = duration{1000};
-  duration profile_acc = duration{0};
-  int cycles_last_second = 0;
-  int cycles_per_second = 0;
+    if (tuning_result result; emu->poll_tuning_result(result)) {
+      finish_tuning(result);
+    }
 
-  // only simulate up to 250ms/iteration
-  // it is possible to get massive timeskips e.g. if the user is resizing the window
-  const duration MAX_SIM_TIME = duration{250};
+    emu->update_frame();
 
-  while (running) {
-    handle_events();
+    render_frame();
 
-    time_point now = clock::now();
-    if (!paused) {
-      duration elapsed = now - last;
-      if (elapsed > MAX_SIM_TIME) {
-        elapsed = MAX_SIM_TIME;
-      }
-      timer_acc += elapsed;
-      cpu_acc += elapsed;
-      profile_acc += elapsed;
+    if (idle) {
+      // already slept in handle_events
+      pacer.mark();
+    } else {
+      pacer.wait(pacer.last_frame() + emu->frame_period());
     }
-    last = now;
+  }
+
+  emu->stop();
+}
+
+bool application::is_idle() const {
+  return paused || emu->frame().cpu.status != cpu_status::ok;
+}
 
-    while (timer_acc > timer_freq.dur()) {
-      audio->play_tone(chip8->st);
-      chip8->dec_timers();
-      timer_acc -= timer_freq.dur();
+void application::toggle_pause() {
+  paused = !paused;
+  if (debug)
+    debug->notify_pause_state(paused);
+  emu->post({emu_command::type::set_paused, paused});
+}
+
+void application::set_cycles_per_frame(int cpf) {
+  cycles_per_frame = cpf;
+  emu->post({emu_command::type::set_cycles_per_frame, cpf});
+  update_title();
+}
+
+void application::set_fast_forward(bool enabled) {
+  fast_forward = enabled;
+  emu->post({emu_command::type::set_fast_forward, enabled});
+  update_title();
+}
+
+void application::render_frame() {
+  const bool debugging = debugger_visible();
+
+  glViewport(0, 0, view_width, view_height);
+  if (debugging) {
+    // the panel is redrawn every frame, and after a swap the whole back buffer is undefined
+    render->invalidate();
+  }
+
+  // when the framebuffer hasn't changed there is nothing to upload, draw or swap
+  bool drew = render->render(emu->frame().framebuf);
+  if (debugging) {
+    debug->render(emu->frame(), pacer.stats());
+    drew = true;
+  }
+
+  // this is the only swap, so there is at most one vsync wait per iteration
+  if (drew) {
+    SDL_GL_SwapWindow(window);
+  }
+}
+
+bool application::debugger_visible() const {
+  return debug && debug->is_visible();
+}
+
+void application::set_debugger_visible(bool visible) {
+  if (visible == debugger_visible())
+    return;
+
+  if (visible) {
+    if (!debug) {
+      debug = std::make_unique<debugger>(window, gl);
+      debug->on_click_pause = [this]() { toggle_pause(); };
+      debug->on_click_step = [this]() { emu->post({emu_command::type::step}); };
+      debug->notify_pause_state(paused);
     }
+    debug->show();
+  } else {
+    debug->hide();
+  }
+
+  // grow or shrink the window by the panel so the display keeps its size
+  if (!fullscreen) {
+    int width, height;
+    SDL_GetWindowSize(window, &width, &height);
+    const int delta = visible ? debugger::PANEL_WIDTH : -debugger::PANEL_WIDTH;
+    SDL_SetWindowSize(window, width + delta, height);
+  }
+  update_viewport();
+}
 
-    while (cpu_acc > cpu_freq.dur()) {
-      chip8->step();
-      ++cycles_last_second;
-      cpu_acc -= cpu_freq.dur();
+void application::load_file(const char* filename_) {
+  // the old rom keeps running until the new one is ready
+  const unsigned serial = ++load_serial;
+
+  jobs->post([this, serial, path = std::string(filename_)]() -> worker::completion {
+    auto result = std::make_shared<loaded_file>();
+    result->path = path;
+    result->vm = std::make_unique<chip8vm>();
+
+    try {
+      if (is_source_file(path.c_str())) {
+        result->success =
+          load_source(*result->vm, path.c_str(), result->assembler, result->program_size);
+      } else {
+        result->success = ::load_file(*result->vm, path.c_str(), result->program_size);
+      }
+    } catch (const syntax_error& e) {
+      result->errmsg = format_syntax_error(e);
+    } catch (const link_error& e) {
+      result->errmsg = format_link_error(e);
+    } catch (const std::exception& e) {
+      result->errmsg = e.what();
     }
 
-    if (profile_acc > profile_delay) {
-      cycles_per_second = cycles_last_second;
-      profile_acc -= profile_delay;
-      cycles_last_second = 0;
+    if (result->success) {
+      result->hash =
+        rom_hash(&result->vm->memory[chip8vm::PROGRAM_START], result->program_size);
     }
 
-    if (debug->is_visible())
-      debug->render(cycles_per_second);
+    return [this, serial, result]() {
+      // a later load supersedes this one
+      if (serial == load_serial)
+        finish_load(std::move(*result));
+    };
+  });
+}
+
+void application::finish_load(loaded_file result) {
+  if (!result.success) {
+    SDL_ShowSimpleMessageBox(
+      SDL_MESSAGEBOX_ERROR, "Unable to load file", result.errmsg.c_str(), NULL);
+    return;
+  }
 
-    render_frame();
+  assembler = std::move(result.assembler);
+  const bool new_file = !filename || *filename != result.path;
+
+  SDL_Log("%s",
+    fmt::format("loaded {} (rom hash {:016x})", result.path, result.hash).c_str());
+
+  const rom_profile* profile = find_rom_profile(result.hash);
+  result.vm->cflags = cfg.cpu.quirks;
+  if (profile) {
+    result.vm->cflags |= profile->quirks;
   }
+  apply_rom_profile(profile, !new_file);
+
+  suggested_cycles_per_frame.reset();
+
+  emu_command cmd{emu_command::type::load};
+  cmd.vm = std::move(result.vm);
+  cmd.rom_id = result.hash;
+  cmd.tune = cfg.cpu.auto_tune != tuning_mode::off && !(profile && profile->cycles_per_frame);
+  emu->post({emu_command::type::set_cycles_per_frame, cycles_per_frame});
+  emu->post(std::move(cmd));
+
+  rom_id = result.hash;
+  filename = std::move(result.path);
+  if (new_file)
+    update_watched_files();
+  update_title();
 }
 
-void application::render_frame() {
-  SDL_GL_MakeCurrent(window, gl);
-  render->render(chip8.get());
-  SDL_GL_SwapWindow(window);
+void application::reload_file() {
+  if (!assembler) {
+    load_file(filename->c_str());
+    return;
+  }
+
+  // reassemble on the worker; only the resulting patch comes back to this thread
+  jobs->post([this, assembler = assembler, path = *filename]() -> worker::completion {
+    std::string errmsg;
+    auto patch = std::make_shared<memory_patch>();
+    bool restart = false;
+    bool has_modules = false;
+    try {
+      // the watcher calls this while an editor may still be rewriting the file, so it's read
+      // into memory rather than mapped
+      std::string source;
+      if (!read_source(path.c_str(), source)) {
+        errmsg = fmt::format("unable to open {}", path);
+      } else if (has_includes(source)) {
+        // an include was added; only a full load can link the modules
+        has_modules = true;
+      } else {
+        const std::vector<byte_range> changes = assembler->update(std::move(source));
+        const std::vector<uint8_t>& program = assembler->bytes();
+
+        if (program.size() > chip8vm::PROGRAM_MAX_SIZE) {
+          errmsg = "program is too large";
+          // the running program no longer matches; start over on the next reload
+          restart = true;
+        }
+        for (const byte_range& r : changes) {
+          patch->ranges.push_back({r.offset, r.size});
+          // bytes past the end of the program belonged to the old one
+          for (std::size_t i = r.offset; i < r.offset + r.size; ++i)
+            patch->bytes.push_back(i < program.size() ? program[i] : 0);
+        }
+      }
+    } catch (const syntax_error& e) {
+      errmsg = format_syntax_error(e);
+    }
+
+    return [this, assembler, patch, errmsg, restart, has_modules]() {
+      if (assembler != this->assembler) {
+        // a different file was loaded in the meantime
+        return;
+      }
+      if (has_modules) {
+        load_file(filename->c_str());
+      } else if (errmsg.size()) {
+        if (restart)
+          this->assembler.reset();
+        SDL_ShowSimpleMessageBox(
+          SDL_MESSAGEBOX_ERROR, "Unable to reload file", errmsg.c_str(), NULL);
+      } else if (!patch->ranges.empty()) {
+        SDL_Log("%s", fmt::format("patched {} ({} bytes in {} ranges)", *filename,
+          patch->bytes.size(), patch->ranges.size()).c_str());
+        emu_command cmd{emu_command::type::patch};
+        cmd.patch = std::make_unique<memory_patch>(std::move(*patch));
+        emu->post(std::move(cmd));
+      }
+    };
+  });
 }
 
-bool application::load_file(const char* filename_) {
-  auto new_state = std::make_unique<chip8vm>();
-  bool success = false;
-  std::string errmsg;
+void application::file_changed(const std::string& path) {
+  if (path == config_path) {
+    reload_config();
+  } else if (filename && path == *filename) {
+    reload_file();
+  }
+}
 
+void application::update_watched_files() {
+  if (!watcher)
+    return;
+  std::vector<std::string> paths{config_path};
+  if (filename)
+    paths.push_back(*filename);
+  watcher->watch(std::move(paths));
+}
+
+const rom_profile* application::find_rom_profile(uint64_t hash) {
   try {
-    success = ::load_file(*new_state, filename_);
-  } catch (const syntax_error& e) {
-    if (e.has_help()) {
-      errmsg =
-        fmt::format("syntax error at {}:{} near `{}': {}\n\n{}", e.line, e.pos, e.context, e.what(), e.help);
-    } else {
-      errmsg =
-        fmt::format("syntax error at {}:{} near `{}': {}", e.line, e.pos, e.context, e.what());
+    return roms->find(hash);
+  } catch (const config_error& e) {
+    std::string errmsg = fmt::format("{}\n\n{}", e.what(), e.context);
+    SDL_ShowSimpleMessageBox(
+      SDL_MESSAGEBOX_ERROR, "Unable to read ROM database", errmsg.c_str(), NULL);
+    return nullptr;
+  }
+}
+
+void application::apply_rom_profile(const rom_profile* profile, bool same_file) {
+  update_keymap(profile);
+
+  if (profile && profile->cycles_per_frame) {
+    cycles_per_frame = *profile->cycles_per_frame;
+  } else if (!same_file) {
+    // keep manual speed adjustments across reloads of the same file, but don't let them leak
+    // into other roms
+    cycles_per_frame = DEFAULT_CYCLES_PER_FRAME;
+  }
+}
+
+void application::update_keymap(const rom_profile* profile) {
+  kmap = cfg.input.kmap;
+
+  if (profile) {
+    for (const auto& [code, key] : profile->keys) {
+      // the profile's binding replaces any existing bindings for the same hex key
+      for (auto it = kmap.begin(); it != kmap.end();) {
+        if (it->second == key)
+          it = kmap.erase(it);
+        else
+          ++it;
+      }
+    }
+    for (const auto& [code, key] : profile->keys) {
+      kmap[code] = key;
     }
-  } catch (const std::exception& e) {
-    errmsg = e.what();
   }
+}
 
-  if (success) {
-    filename = filename_;
-    chip8 = std::move(new_state);
-    debug->set_state(chip8.get());
-    update_title();
+void application::finish_tuning(const tuning_result& result) {
+  if (result.rom_id != rom_id) {
+    // a different rom was loaded while this one was being tuned
+    return;
+  }
+
+  const std::optional<int> recommended = result.cycles_per_frame;
+
+  if (!recommended) {
+    SDL_Log("auto tuning: rom uses its entire cycle budget; keeping %d cycles/frame",
+      cycles_per_frame);
+    return;
+  }
+
+  SDL_Log("auto tuning: rom needs %d cycles/frame", *recommended);
+
+  if (cfg.cpu.auto_tune == tuning_mode::apply) {
+    cycles_per_frame = *recommended;
+    emu->post({emu_command::type::set_cycles_per_frame, cycles_per_frame});
   } else {
-    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Unable to load file", errmsg.c_str(), NULL);
+    suggested_cycles_per_frame = recommended;
   }
 
-  return success;
+  if (cfg.cpu.save_tuning) {
+    try {
+      if (!roms->save_cycles_per_frame(rom_id, *recommended)) {
+        SDL_Log("auto tuning: unable to write rom database");
+      }
+    } catch (const config_error& e) {
+      SDL_Log("auto tuning: %s: %s", e.what(), e.context.c_str());
+    }
+  }
+
+  update_title();
 }
 
 void application::update_title() {
   std::string title;
   if (filename) {
-    title = fmt::format("{} - {} cycles/sec", *filename, cpu_freq.hz());
+    title = fmt::format("{} - {} cycles/frame", *filename, cycles_per_frame);
   } else {
-    title = fmt::format("[no rom loaded] - {} cycles/sec", cpu_freq.hz());
+    title = fmt::format("[no rom loaded] - {} cycles/frame", cycles_per_frame);
+  }
+  if (suggested_cycles_per_frame) {
+    title += fmt::format(" (suggested: {})", *suggested_cycles_per_frame);
+  }
+  if (fast_forward) {
+    title += " [fast forward]";
   }
   SDL_SetWindowTitle(window, title.c_str());
 }
@@ -363,16 +629,63 @@ void application::load_config() {
   std::string path_str = base_path;
   SDL_free(base_path);
 
-  auto p = path(path_str) / "config.toml";
+  config_path = (path(path_str) / "config.toml").string();
 
-  cfg = ::load_config(p.string());
+  cfg = ::load_config(config_path);
+  kmap = cfg.input.kmap;
+
+  roms = std::make_unique<romdb>((path(path_str) / "romdb.toml").string());
+}
+
+void application::reload_config() {
+  jobs->post([this, path = config_path]() -> worker::completion {
+    try {
+      auto next = std::make_shared<application_config>(::load_config(path));
+      return [this, next]() { apply_config(std::move(*next)); };
+    } catch (const config_error& e) {
+      std::string errmsg = fmt::format("{}\n\n{}", e.what(), e.context);
+      return [errmsg]() {
+        SDL_ShowSimpleMessageBox(
+          SDL_MESSAGEBOX_ERROR, "Unable to reload config", errmsg.c_str(), NULL);
+      };
+    } catch (const std::exception& e) {
+      std::string errmsg = e.what();
+      return [errmsg]() {
+        SDL_ShowSimpleMessageBox(
+          SDL_MESSAGEBOX_ERROR, "Unable to reload config", errmsg.c_str(), NULL);
+      };
+    }
+  });
+}
+
+void application::apply_config(application_config next) {
+  // these are only read at startup
+  next.audio = cfg.audio;
+  next.latency = cfg.latency;
+  next.fast_forward = cfg.fast_forward;
+  next.watch = cfg.watch;
+  const bool debug_changed = next.debug.visible != cfg.debug.visible;
+  cfg = std::move(next);
+
+  update_keymap(filename ? find_rom_profile(rom_id) : nullptr);
+  pacer.set_vsync(cfg.display.vsync);
+  render->set_background_color(cfg.display.render_background);
+  render->set_foreground_color(cfg.display.render_foreground);
+  render->invalidate();
+  if (debug_changed)
+    set_debugger_visible(cfg.debug.visible);
+  SDL_Log("reloaded %s", config_path.c_str());
 }
 
 void application::update_viewport() {
   int width, height;
   SDL_GetWindowSize(window, &width, &height);
-  SDL_GL_MakeCurrent(window, gl);
-  glViewport(0, 0, width, height);
+  if (debugger_visible()) {
+    width = std::max(width - debugger::PANEL_WIDTH, 1);
+  }
+  view_width = width;
+  view_height = height;
+  render->invalidate();
 }
 
 void application::toggle_fullscreen() {
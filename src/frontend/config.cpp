@@ -46,6 +46,7 @@ void load_input_config(const toml::value& n, input_config& input) {
   input.toggle_debugger = KEY_FOR("toggle_debugger");
   input.increase_cycles = KEY_FOR("increase_cycles");
   input.decrease_cycles = KEY_FOR("decrease_cycles");
+  input.fast_forward = KEY_FOR("fast_forward");
 }
 
 void load_audio_config(const toml::value& n, audio_config& audio) {
@@ -53,15 +54,76 @@ void load_audio_config(const toml::value& n, audio_config& audio) {
   audio.samples = integral_cast<int>(n.at("samples").as_integer());
 }
 
+vsync_mode vsync_mode_from_string(const std::string& name) {
+  if (name == "off") {
+    return vsync_mode::off;
+  } else if (name == "on") {
+    return vsync_mode::on;
+  } else if (name == "adaptive") {
+    return vsync_mode::adaptive;
+  } else {
+    throw config_error("vsync must be one of \"off\", \"on\", or \"adaptive\"", name);
+  }
+}
+
 void load_display_config(const toml::value& n, display_config& display) {
   display.render_background = toml::get<color4i>(n.at("background"));
   display.render_foreground = toml::get<color4i>(n.at("foreground"));
+  display.vsync = vsync_mode_from_string(n.at("vsync").as_string());
 }
 
 void load_debug_config(const toml::value& n, debug_config& debug) {
   debug.visible = n.at("visible").as_boolean();
 }
 
+tuning_mode tuning_mode_from_string(const std::string& name) {
+  if (name == "off") {
+    return tuning_mode::off;
+  } else if (name == "recommend") {
+    return tuning_mode::recommend;
+  } else if (name == "apply") {
+    return tuning_mode::apply;
+  } else {
+    throw config_error("auto_tune must be one of \"off\", \"recommend\", or \"apply\"", name);
+  }
+}
+
+void load_cpu_config(const toml::value& n, cpu_config& cpu) {
+  cpu.auto_tune = tuning_mode_from_string(n.at("auto_tune").as_string());
+  cpu.save_tuning = n.at("save_tuning").as_boolean();
+  if (n.at("display_wait").as_boolean()) {
+    cpu.quirks |= compat_flags::display_wait;
+  }
+}
+
+void load_latency_config(const toml::value& n, latency_config& latency) {
+  // beyond a few frames, the cost grows while the presented frames start to mispredict
+  const int MAX_RUN_AHEAD = 4;
+  latency.run_ahead = integral_cast<int>(n.at("run_ahead").as_integer());
+  if (latency.run_ahead < 0 || latency.run_ahead > MAX_RUN_AHEAD) {
+    throw config_error("run_ahead must be between 0 and 4", std::to_string(latency.run_ahead));
+  }
+}
+
+void load_fast_forward_config(const toml::value& n, fast_forward_config& ff) {
+  ff.speed = integral_cast<int>(n.at("speed").as_integer());
+  if (ff.speed < 0) {
+    throw config_error("speed must be 0 or greater", std::to_string(ff.speed));
+  }
+  ff.present_every = integral_cast<int>(n.at("present_every").as_integer());
+  if (ff.present_every < 1) {
+    throw config_error("present_every must be 1 or greater", std::to_string(ff.present_every));
+  }
+}
+
+void load_watch_config(const toml::value& n, watch_config& watch) {
+  watch.enabled = n.at("enabled").as_boolean();
+  watch.debounce_ms = integral_cast<int>(n.at("debounce_ms").as_integer());
+  if (watch.debounce_ms < 0) {
+    throw config_error("debounce_ms must be 0 or greater", std::to_string(watch.debounce_ms));
+  }
+}
+
 application_config load_config(const std::string& path) {
   application_config cfg;
 
@@ -77,6 +139,10 @@ application_config load_config(const std::string& path) {
     load_audio_config(data.at("audio"), cfg.audio);
     load_display_config(data.at("display"), cfg.display);
     load_debug_config(data.at("debug"), cfg.debug);
+    load_cpu_config(data.at("cpu"), cfg.cpu);
+    load_latency_config(data.at("latency"), cfg.latency);
+    load_fast_forward_config(data.at("fast_forward"), cfg.fast_forward);
+    load_watch_config(data.at("watch"), cfg.watch);
   } catch (const toml::type_error& e) {
     throw config_error("config setting has an incorrect type", e.what());
   } catch (const bad_integral_cast& e) {
@@ -20,60 +20,24 @@
 #include "imgui_impl_sdl.h"
 #include <gl/gl3w.h>
 #include <fmt/format.h>
+#include <cstring>
 
-debugger::debugger() {
-  _window = SDL_CreateWindow("debugger",
-    SDL_WINDOWPOS_CENTERED,
-    SDL_WINDOWPOS_CENTERED,
-    300,
-    512,
-    SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIDDEN);
-  _gl = SDL_GL_CreateContext(_window);
-  _windowid = SDL_GetWindowID(_window);
-
+debugger::debugger(SDL_Window* window, SDL_GLContext gl) : _window{window} {
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
 
-  ImGui_ImplSDL2_InitForOpenGL(_window, _gl);
+  ImGui_ImplSDL2_InitForOpenGL(_window, gl);
   ImGui_ImplOpenGL3_Init("#version 130");
 }
 
 debugger::~debugger() {
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplSDL2_Shutdown();
-  SDL_GL_DeleteContext(_gl);
-  SDL_DestroyWindow(_window);
-}
-
-bool debugger::is_visible() const {
-  Uint32 flags = SDL_GetWindowFlags(_window);
-  return flags & SDL_WINDOW_SHOWN;
-}
-
-void debugger::show() {
-  SDL_ShowWindow(_window);
-}
-
-void debugger::hide() {
-  SDL_HideWindow(_window);
-}
-
-void debugger::toggle_visibility() {
-  if (is_visible()) {
-    hide();
-  } else {
-    show();
-  }
-}
-
-void debugger::set_state(chip8vm* chip8) {
-  _chip8 = chip8;
+  ImGui::DestroyContext();
 }
 
-void debugger::render(int cps) {
-  SDL_GL_MakeCurrent(_window, _gl);
-
-  ImGuiIO& io = ImGui::GetIO();
+void debugger::render(const frame_snapshot& frame, const frame_stats& frame_times) {
+  const cpu_snapshot& cpu = frame.cpu;
 
   ImGui::StyleColorsDark();
 
@@ -84,39 +48,50 @@ void debugger::render(int cps) {
   ImGui_ImplSDL2_NewFrame(_window);
   ImGui::NewFrame();
 
-  ImGui::SetNextWindowPos(ImVec2(0, 0));
-  ImGui::SetNextWindowSize(ImVec2(static_cast<float>(window_w), static_cast<float>(window_h)));
+  const float panel_x = static_cast<float>(window_w - PANEL_WIDTH);
+  ImGui::SetNextWindowPos(ImVec2(panel_x, 0));
+  ImGui::SetNextWindowSize(ImVec2(static_cast<float>(PANEL_WIDTH), static_cast<float>(window_h)));
   ImGui::GetStyle().WindowRounding = 0.0f;
 
   ImGui::Begin(
     "debug", 0, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
 
-  ImGui::Text("cycles/sec: %d", cps);
-  ImGui::Text("cpu status: %s", cpu_status_str(_chip8->status));
+  ImGui::Text("cycles/sec: %d", frame.cycles_per_second);
+  ImGui::Text("frame time: %.2f ms", frame_times.last_ms);
+  ImGui::Text("  avg %.2f, min %.2f, max %.2f",
+    frame_times.avg_ms,
+    frame_times.min_ms,
+    frame_times.max_ms);
+  if (frame.run_ahead > 0) {
+    ImGui::Text("run-ahead: %d frames, %.3f ms/frame", frame.run_ahead, frame.run_ahead_ms);
+  }
+  ImGui::Text("cpu status: %s", cpu_status_str(cpu.status));
 
   ImGui::BeginGroup();
   ImGui::Columns(2, NULL, false);
   for (int y = 0; y < 8; y++) {
-    ImGui::Text("v%x = %02x", y, _chip8->variables[y]);
+    ImGui::Text("v%x = %02x", y, cpu.variables[y]);
   }
   ImGui::NextColumn();
   for (int y = 8; y < 16; y++) {
-    ImGui::Text("v%x = %02x", y, _chip8->variables[y]);
+    ImGui::Text("v%x = %02x", y, cpu.variables[y]);
   }
   ImGui::Columns(1);
   ImGui::Spacing();
-  ImGui::Text("dt = %02x", _chip8->dt);
-  ImGui::Text("st = %02x", _chip8->st);
-  ImGui::Text(" i = %04x", _chip8->i);
+  ImGui::Text("dt = %02x", cpu.dt);
+  ImGui::Text("st = %02x", cpu.st);
+  ImGui::Text(" i = %04x", cpu.i);
   ImGui::EndGroup();
 
   ImGui::Separator();
 
   ImGui::BeginGroup();
-  for (int pco = _chip8->pc - 16, y = 0; pco <= _chip8->pc + 16; pco += 2, ++y) {
-    uint16_t* instr = reinterpret_cast<uint16_t*>(&_chip8->memory[pco]);
-    const auto dinstr = decode(*instr);
-    const auto* meta = _omtbl.find_opcode(dinstr.opcode);
+  for (int offset = 0; offset + 1 < cpu_snapshot::CODE_SIZE; offset += 2) {
+    const int pco = cpu.pc - cpu_snapshot::CODE_BEFORE_PC + offset;
+    uint16_t instr;
+    std::memcpy(&instr, &cpu.code[offset], sizeof(instr));
+    const auto dinstr = decode(instr);
+    const auto* meta = opmetas.find_opcode(dinstr.opcode);
     std::string label;
     if (meta) {
       switch (meta->parameter_count()) {
@@ -147,14 +122,14 @@ void debugger::render(int cps) {
       label = "[unknown]";
     }
     ImVec4 color;
-    if (pco == _chip8->pc) {
+    if (pco == cpu.pc) {
       color = ImVec4(1, 1, 0, 1);
     } else {
       color = ImVec4(1, 1, 1, 1);
     }
     ImGui::TextColored(color, "%04x", pco);
     ImGui::SameLine();
-    ImGui::TextColored(color, "%04x", decode(*instr).opcode);
+    ImGui::TextColored(color, "%04x", dinstr.opcode);
     ImGui::SameLine();
     ImGui::TextColored(color, label.c_str());
   }
@@ -177,23 +152,26 @@ void debugger::render(int cps) {
   ImGui::End();
 
   ImGui::Render();
-  glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  SDL_GL_SwapWindow(_window);
 }
 
-void debugger::set_position(int x, int y) {
-  SDL_SetWindowPosition(_window, x, y);
-}
-
-void debugger::process_event(const SDL_Event& ev) {
-  if (ImGui_ImplSDL2_ProcessEvent(&ev)) {
-    return;
-  }
-
-  if (ev.type == SDL_WINDOWEVENT && ev.window.event == SDL_WINDOWEVENT_CLOSE) {
-    hide();
+bool debugger::process_event(const SDL_Event& ev) {
+  ImGui_ImplSDL2_ProcessEvent(&ev);
+
+  // imgui takes every event it understands; only keep the ones it actually needs so that
+  // emulator keys and clicks outside the panel still work
+  const ImGuiIO& io = ImGui::GetIO();
+  switch (ev.type) {
+  case SDL_MOUSEWHEEL:
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+  case SDL_MOUSEMOTION:
+    return io.WantCaptureMouse;
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+  case SDL_TEXTINPUT:
+    return io.WantCaptureKeyboard;
+  default:
+    return false;
   }
 }
\ No newline at end of file
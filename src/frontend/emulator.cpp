@@ -0,0 +1,313 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frontend/emulator.hpp"
+#include "frontend/audio.hpp"
+#include "frontend/pacer.hpp"
+#include <algorithm>
+
+void cpu_snapshot::capture(const chip8vm& vm) {
+  variables = vm.variables;
+  status = vm.status;
+  pc = vm.pc;
+  i = vm.i;
+  dt = vm.dt;
+  st = vm.st;
+  for (int n = 0; n < CODE_SIZE; ++n) {
+    const int address = pc - CODE_BEFORE_PC + n;
+    const bool in_memory = address >= 0 && address < static_cast<int>(vm.memory.size());
+    code[n] = in_memory ? vm.memory[address] : 0;
+  }
+}
+
+emulator::emulator(audio_context& audio,
+  int cycles_per_frame,
+  const latency_config& latency,
+  const fast_forward_config& fast_forward)
+  : _audio{audio},
+    _vm{std::make_unique<chip8vm>()},
+    _cycles_per_frame{cycles_per_frame},
+    _ff{fast_forward},
+    _run_ahead{latency.run_ahead} {
+  if (_run_ahead > 0)
+    _ahead = std::make_unique<chip8vm>();
+}
+
+emulator::~emulator() {
+  stop();
+}
+
+void emulator::start() {
+  if (_thread.joinable())
+    return;
+  _quit = false;
+  _thread = std::thread(&emulator::thread_main, this);
+}
+
+void emulator::stop() {
+  if (!_thread.joinable())
+    return;
+  _quit = true;
+  _thread.join();
+  _audio.play_tone(0);
+
+  // drop anything posted after the thread stopped reading commands
+  emu_command cmd;
+  while (_commands.pop(cmd)) {
+  }
+}
+
+void emulator::post(emu_command cmd) {
+  // the emulation thread drains the queue at least once a frame, so this only waits if the
+  // main thread somehow outpaces it by a few hundred commands
+  while (!_commands.push(std::move(cmd))) {
+    std::this_thread::yield();
+  }
+}
+
+void emulator::thread_main() {
+  // only simulate up to 250ms/iteration
+  // it is possible to get massive timeskips e.g. if the host is suspended
+  const duration MAX_SIM_TIME = std::chrono::milliseconds{250};
+  // how often commands are checked while paused or halted
+  const duration IDLE_POLL = std::chrono::milliseconds{10};
+
+  publish(*_vm);
+  time_point last = clock::now();
+
+  while (!_quit.load(std::memory_order_acquire)) {
+    process_commands();
+
+    const time_point now = clock::now();
+    const bool uncapped = _fast_forward && _ff.speed == 0;
+    const int speed = _fast_forward ? _ff.speed : 1;
+
+    if (!_paused) {
+      const duration elapsed = std::min(now - last, MAX_SIM_TIME);
+      if (uncapped) {
+        present(emulate_uncapped(now));
+      } else {
+        const int due = _frames.advance(elapsed * speed);
+        const duration period = _frames.period() / speed;
+        for (int i = 0; i < due; ++i) {
+          // frames that became due together are laid out back to back, ending now
+          emulate_frame(now - (due - i) * period, period);
+        }
+        present(due);
+      }
+      update_profile(elapsed);
+    }
+    last = now;
+
+    if (_paused || _vm->status != cpu_status::ok) {
+      precise_sleep_until(now + IDLE_POLL);
+    } else if (!uncapped) {
+      precise_sleep_until(now + _frames.until_next() / speed);
+    }
+  }
+}
+
+void emulator::process_commands() {
+  emu_command cmd;
+  while (_commands.pop(cmd)) {
+    process_command(cmd);
+  }
+}
+
+void emulator::process_command(emu_command& cmd) {
+  switch (cmd.kind) {
+  case emu_command::type::key_down:
+  case emu_command::type::key_up:
+    queue_key(cmd);
+    break;
+  case emu_command::type::set_paused:
+    _paused = cmd.value != 0;
+    if (_paused)
+      _audio.play_tone(0);
+    break;
+  case emu_command::type::set_fast_forward:
+    _fast_forward = cmd.value != 0;
+    _frames_unshown = 0;
+    if (!_fast_forward) {
+      // don't leave the display up to present_every frames behind
+      _frames.reset();
+      publish(*_vm);
+    }
+    break;
+  case emu_command::type::step:
+    _vm->step();
+    publish(*_vm);
+    break;
+  case emu_command::type::set_cycles_per_frame:
+    _cycles_per_frame = cmd.value;
+    break;
+  case emu_command::type::load:
+    _vm = std::move(cmd.vm);
+    _shown_source = nullptr;
+    _rom_id = cmd.rom_id;
+    _pending_keys.clear();
+    if (cmd.tune) {
+      _tuner.emplace();
+    } else {
+      _tuner.reset();
+    }
+    _frames.reset();
+    publish(*_vm);
+    break;
+  case emu_command::type::patch: {
+    const uint8_t* bytes = cmd.patch->bytes.data();
+    for (const memory_patch::range& r : cmd.patch->ranges) {
+      std::copy_n(bytes, r.size, &_vm->memory[chip8vm::PROGRAM_START + r.offset]);
+      bytes += r.size;
+    }
+    break;
+  }
+  }
+}
+
+void emulator::queue_key(const emu_command& cmd) {
+  const auto key = static_cast<chip8_key>(cmd.value);
+  const bool pressed = cmd.kind == emu_command::type::key_down;
+
+  if (_paused) {
+    // there are no frames to place it in; make it visible to single steps right away
+    _vm->inp.set_key_state(key, pressed);
+  } else {
+    _pending_keys.push_back({cmd.time, key, pressed});
+  }
+}
+
+void emulator::emulate_frame(time_point begin, duration length) {
+  // convert the keys that changed during this frame to cycle offsets within it
+  _frame_input.clear();
+  auto it = _pending_keys.begin();
+  for (; it != _pending_keys.end() && it->time < begin + length; ++it) {
+    const duration offset = std::max(it->time - begin, duration{0});
+    int cycle = static_cast<int>(offset * _cycles_per_frame / length);
+    // timestamps come from the main thread's view of the clock and may be slightly out of
+    // order; never reorder the events themselves
+    if (!_frame_input.empty())
+      cycle = std::max(cycle, _frame_input.back().cycle);
+    _frame_input.push_back({cycle, it->key, it->pressed});
+  }
+  _pending_keys.erase(_pending_keys.begin(), it);
+
+  const input_event* first = _frame_input.data();
+  const input_event* last = first + _frame_input.size();
+  if (_tuner) {
+    _cycles_executed += _vm->run(
+      _cycles_per_frame, first, last, [this](const chip8vm& vm) { _tuner->observe(vm); });
+  } else {
+    _cycles_executed += _vm->run(_cycles_per_frame, first, last, [](const chip8vm&) {});
+  }
+
+  _vm->dec_timers();
+  // fast forwarded sound would just be noise
+  _audio.play_tone(_fast_forward ? 0 : _vm->st);
+
+  if (_tuner) {
+    _tuner->end_frame(_vm->waiting_for_vblank());
+    if (_tuner->finished()) {
+      // there is only ever one tuning result per load, so this can't overflow in practice
+      _results.push({_rom_id, _tuner->recommendation()});
+      _tuner.reset();
+    }
+  }
+}
+
+int emulator::emulate_uncapped(time_point now) {
+  const duration period = _frames.period();
+  const time_point slice_end = now + period;
+
+  int frames = 0;
+  do {
+    emulate_frame(now - period, period);
+    ++frames;
+  } while (clock::now() < slice_end && _vm->status == cpu_status::ok);
+
+  // nothing is owed to the frame clock for time spent here
+  _frames.reset();
+  return frames;
+}
+
+void emulator::present(int frames) {
+  if (frames <= 0)
+    return;
+
+  if (_fast_forward) {
+    _frames_unshown += frames;
+    if (_frames_unshown >= _ff.present_every) {
+      _frames_unshown = 0;
+      publish(*_vm);
+    }
+  } else if (_ahead && _vm->status == cpu_status::ok) {
+    // only the newest frame is presented, so only it needs to be run ahead
+    run_ahead();
+    publish(*_ahead);
+  } else {
+    publish(*_vm);
+  }
+}
+
+void emulator::update_profile(duration elapsed) {
+  const duration PROFILE_DELAY = std::chrono::seconds{1};
+
+  _profile_acc += elapsed;
+  if (_profile_acc > PROFILE_DELAY) {
+    _cycles_per_second = _cycles_executed;
+    _cycles_executed = 0;
+    _profile_acc -= PROFILE_DELAY;
+
+    const std::chrono::duration<float, std::milli> ahead_time = _run_ahead_acc;
+    _run_ahead_ms = _run_ahead_count ? ahead_time.count() / _run_ahead_count : 0;
+    _run_ahead_acc = duration{0};
+    _run_ahead_count = 0;
+  }
+}
+
+void emulator::run_ahead() {
+  const time_point start = clock::now();
+
+  // copy assignment reuses the allocations from the previous frame
+  *_ahead = *_vm;
+  for (const pending_key& k : _pending_keys)
+    _ahead->inp.set_key_state(k.key, k.pressed);
+  for (int i = 0; i < _run_ahead && _ahead->status == cpu_status::ok; ++i) {
+    _ahead->run(_cycles_per_frame);
+    _ahead->dec_timers();
+  }
+
+  _run_ahead_acc += clock::now() - start;
+  ++_run_ahead_count;
+}
+
+void emulator::publish(chip8vm& shown) {
+  frame_snapshot& out = _frames_out.back();
+  // the renderer only uploads rows changed since the generation it saw last, which is only
+  // meaningful if this frame descends from the previous one. anything else is uploaded in
+  // full. touching the source rather than the copy keeps later frames from _vm comparable
+  const bool continues = &shown == _vm.get() && _shown_source == _vm.get();
+  if (!continues) {
+    shown.framebuf.touch_all(_shown_generation);
+  }
+  _shown_source = &shown == _vm.get() ? _vm.get() : nullptr;
+  _shown_generation = shown.framebuf.generation();
+  out.framebuf = shown.framebuf;
+  // the debugger always shows the real state
+  out.cpu.capture(*_vm);
+  out.cycles_per_second = _cycles_per_second;
+  out.run_ahead = &shown == _vm.get() ? 0 : _run_ahead;
+  out.run_ahead_ms = _run_ahead_ms;
+  _frames_out.publish();
+}
@@ -0,0 +1,222 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frontend/file_watcher.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+file_watcher::file_watcher(std::chrono::milliseconds debounce, callback on_change)
+  : _debounce{debounce},
+    _on_change{std::move(on_change)},
+#ifdef __linux__
+    _wake_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+#endif
+    _thread{&file_watcher::thread_main, this} {
+}
+
+file_watcher::~file_watcher() {
+  {
+    std::lock_guard lock{_mutex};
+    _quit = true;
+  }
+  wake();
+  _thread.join();
+#ifdef __linux__
+  if (_wake_fd >= 0)
+    close(_wake_fd);
+#endif
+}
+
+void file_watcher::watch(std::vector<std::string> paths) {
+  {
+    std::lock_guard lock{_mutex};
+    _paths = std::move(paths);
+    _paths_changed = true;
+  }
+  wake();
+}
+
+void file_watcher::wake() {
+  _wake.notify_one();
+#ifdef __linux__
+  const uint64_t one = 1;
+  [[maybe_unused]] const ssize_t written = write(_wake_fd, &one, sizeof(one));
+#endif
+}
+
+void file_watcher::thread_main() {
+#ifdef __linux__
+  if (run_inotify())
+    return;
+#endif
+  run_polling();
+}
+
+#ifdef __linux__
+bool file_watcher::run_inotify() {
+  const int fd = _wake_fd >= 0 ? inotify_init1(IN_NONBLOCK | IN_CLOEXEC) : -1;
+  if (fd < 0)
+    return false;
+
+  using clock = std::chrono::steady_clock;
+
+  // editors often save by writing a new file and renaming it over the old one, which a watch
+  // on the file itself would lose track of, so the containing directories are watched instead
+  struct target {
+    int wd;
+    std::string name;
+    std::string path;
+  };
+  std::vector<target> targets;
+  // watched path -> when it last changed
+  std::map<std::string, clock::time_point> pending;
+
+  const auto rewatch = [&](const std::vector<std::string>& paths) {
+    for (const target& t : targets)
+      inotify_rm_watch(fd, t.wd);
+    targets.clear();
+    pending.clear();
+    for (const std::string& p : paths) {
+      fs::path dir = fs::path(p).parent_path();
+      if (dir.empty())
+        dir = ".";
+      // adding the same directory twice returns the same descriptor
+      const int wd = inotify_add_watch(
+        fd, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+      if (wd >= 0)
+        targets.push_back({wd, fs::path(p).filename().string(), p});
+    }
+  };
+
+  for (;;) {
+    {
+      std::lock_guard lock{_mutex};
+      if (_quit)
+        break;
+      if (_paths_changed) {
+        _paths_changed = false;
+        rewatch(_paths);
+      }
+    }
+
+    // sleep until something happens or the oldest change has settled
+    int timeout_ms = -1;
+    if (!pending.empty()) {
+      auto settled = clock::time_point::max();
+      for (const auto& [path, changed] : pending)
+        settled = std::min(settled, changed + _debounce);
+      const auto wait = std::chrono::ceil<std::chrono::milliseconds>(settled - clock::now());
+      timeout_ms = static_cast<int>(std::max(wait.count(), std::chrono::milliseconds::rep{0}));
+    }
+
+    pollfd fds[2] = {{fd, POLLIN, 0}, {_wake_fd, POLLIN, 0}};
+    poll(fds, 2, timeout_ms);
+
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      [[maybe_unused]] const ssize_t cleared = read(_wake_fd, &count, sizeof(count));
+    }
+
+    if (fds[0].revents & POLLIN) {
+      alignas(inotify_event) char buffer[4096];
+      ssize_t size;
+      while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (const char* p = buffer; p < buffer + size;) {
+          const auto* ev = reinterpret_cast<const inotify_event*>(p);
+          p += sizeof(inotify_event) + ev->len;
+          if (!ev->len)
+            continue;
+          for (const target& t : targets) {
+            if (t.wd == ev->wd && t.name == ev->name)
+              pending[t.path] = clock::now();
+          }
+        }
+      }
+    }
+
+    const auto now = clock::now();
+    for (auto it = pending.begin(); it != pending.end();) {
+      if (now - it->second >= _debounce) {
+        _on_change(it->first);
+        it = pending.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  close(fd);
+  return true;
+}
+#endif
+
+void file_watcher::run_polling() {
+  const auto POLL_INTERVAL = std::max<std::chrono::milliseconds>(_debounce, 250ms);
+
+  using clock = std::chrono::steady_clock;
+
+  struct file_state {
+    fs::file_time_type reported;
+    fs::file_time_type seen;
+    clock::time_point seen_at;
+  };
+  std::map<std::string, file_state> files;
+
+  const auto modified = [](const std::string& path) {
+    std::error_code ec;
+    const auto time = fs::last_write_time(path, ec);
+    return ec ? fs::file_time_type::min() : time;
+  };
+
+  for (;;) {
+    {
+      std::unique_lock lock{_mutex};
+      _wake.wait_for(lock, POLL_INTERVAL, [this]() { return _quit || _paths_changed; });
+      if (_quit)
+        return;
+      if (_paths_changed) {
+        _paths_changed = false;
+        files.clear();
+        for (const std::string& p : _paths) {
+          const auto time = modified(p);
+          files[p] = {time, time, clock::now()};
+        }
+      }
+    }
+
+    // a change is reported once the modification time stops moving
+    const auto now = clock::now();
+    for (auto& [path, state] : files) {
+      const auto time = modified(path);
+      if (time != state.seen) {
+        state.seen = time;
+        state.seen_at = now;
+      } else if (state.seen != state.reported && now - state.seen_at >= _debounce) {
+        state.reported = state.seen;
+        _on_change(path);
+      }
+    }
+  }
+}
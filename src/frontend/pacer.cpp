@@ -0,0 +1,91 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frontend/pacer.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <thread>
+
+void precise_sleep_until(std::chrono::steady_clock::time_point deadline) {
+  using clock = std::chrono::steady_clock;
+  const auto SPIN_TIME = std::chrono::milliseconds{2};
+
+  auto now = clock::now();
+  while (deadline - now > SPIN_TIME) {
+    std::this_thread::sleep_for(deadline - now - SPIN_TIME);
+    now = clock::now();
+  }
+  while (clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+vsync_mode frame_pacer::set_vsync(vsync_mode mode) {
+  switch (mode) {
+  case vsync_mode::adaptive:
+    if (SDL_GL_SetSwapInterval(-1) == 0) {
+      _vsync = vsync_mode::adaptive;
+      break;
+    }
+    // late swap tearing isn't supported everywhere; regular vsync is the next best thing
+    [[fallthrough]];
+  case vsync_mode::on:
+    _vsync = SDL_GL_SetSwapInterval(1) == 0 ? vsync_mode::on : vsync_mode::off;
+    break;
+  case vsync_mode::off:
+    SDL_GL_SetSwapInterval(0);
+    _vsync = vsync_mode::off;
+    break;
+  }
+  return _vsync;
+}
+
+void frame_pacer::wait(time_point deadline) {
+  if (_vsync != vsync_mode::off && _last != time_point{}) {
+    // a swap that blocked on vblank takes about one refresh period; if this one didn't, pace
+    // the loop as if it had
+    const int refresh = _refresh_rate > 0 ? _refresh_rate : 60;
+    const duration expected = duration{std::chrono::seconds{1}} / refresh;
+    deadline = _last + expected * 3 / 4;
+  }
+
+  if (clock::now() < deadline) {
+    precise_sleep_until(deadline);
+  }
+
+  record(clock::now());
+}
+
+void frame_pacer::mark() {
+  record(clock::now());
+}
+
+void frame_pacer::record(time_point now) {
+  if (_last != time_point{}) {
+    const std::chrono::duration<float, std::milli> frame_time = now - _last;
+    _times[_time_index] = frame_time.count();
+    _time_index = (_time_index + 1) % _times.size();
+    _time_count = std::min(_time_count + 1, _times.size());
+
+    const auto first = _times.begin();
+    const auto last = _times.begin() + _time_count;
+    _stats.last_ms = frame_time.count();
+    _stats.min_ms = *std::min_element(first, last);
+    _stats.max_ms = *std::max_element(first, last);
+    float sum = 0;
+    std::for_each(first, last, [&](float t) { sum += t; });
+    _stats.avg_ms = sum / _time_count;
+  }
+  _last = now;
+}
@@ -13,7 +13,9 @@
 // limitations under the License.
 
 #include "frontend/renderer.hpp"
-#include "emu/vm.hpp"
+#include "emu/framebuffer.hpp"
+#include <SDL.h>
+#include <cstring>
 
 const char* vertex_shader_src = R"(
 #version 330 core
@@ -32,16 +34,21 @@ const char* fragment_shader_src = R"(
 out vec4 FragColor;
 in vec2 TexCoord;
 
-uniform sampler2D ourTexture;
+// 8 pixels per texel, leftmost in the most significant bit
+uniform usampler2D ourTexture;
 
 uniform vec4 foreground_color;
 uniform vec4 background_color;
 
 void main() {
+  ivec2 size = textureSize(ourTexture, 0) * ivec2(8, 1);
+  ivec2 pixel = min(ivec2(TexCoord * vec2(size)), size - 1);
+  uint bits = texelFetch(ourTexture, ivec2(pixel.x / 8, pixel.y), 0).r;
+  uint on = (bits >> (7 - pixel.x % 8)) & 1u;
   FragColor = mix(
     background_color,
     foreground_color,
-    texture(ourTexture, TexCoord).r
+    float(on)
   );
 } 
 )";
@@ -86,9 +93,15 @@ renderer::renderer() {
 
   dims.width = 0;
   dims.height = 0;
+  dims.stride = 0;
+
+  // core since 4.4, but common as an extension on 3.3 drivers
+  has_buffer_storage = glBufferStorage &&
+    (gl3wIsSupported(4, 4) || SDL_GL_ExtensionSupported("GL_ARB_buffer_storage"));
 }
 
 renderer::~renderer() {
+  destroy_upload_ring();
   glDeleteTextures(1, &emu_texture);
   glDeleteProgram(shader_prog);
   glDeleteShader(fragment_shader);
@@ -97,36 +110,42 @@ renderer::~renderer() {
   glDeleteVertexArrays(1, &vertex_array);
 }
 
-void renderer::render(const chip8vm* chip8) {
+bool renderer::render(const framebuffer& fb) {
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, emu_texture);
 
   // if output dimensions changed, we have to reallocate texture storage using new dimensions
-  int fbwidth = static_cast<int>(chip8->framebuf.width());
-  int fbheight = static_cast<int>(chip8->framebuf.height());
+  int fbwidth = static_cast<int>(fb.width());
+  int fbheight = static_cast<int>(fb.height());
   if (fbwidth != dims.width || fbheight != dims.height) {
     dims.width = fbwidth;
     dims.height = fbheight;
+    dims.stride = static_cast<int>(fb.stride());
     glTexImage2D(GL_TEXTURE_2D,
       0,
-      GL_RGB,
-      dims.width,
+      GL_R8UI,
+      dims.stride,
       dims.height,
       0,
-      GL_RED,
-      GL_UNSIGNED_BYTE,
-      chip8->framebuf.data());
-  } else {
-    glTexSubImage2D(GL_TEXTURE_2D,
-      0,
-      0,
-      0,
-      dims.width,
-      dims.height,
-      GL_RED,
+      GL_RED_INTEGER,
       GL_UNSIGNED_BYTE,
-      chip8->framebuf.data());
+      nullptr);
+    const std::size_t size = fb.stride() * fb.height();
+    if (size > upload_segment_size) {
+      create_upload_ring(size);
+    }
+    upload_rows(fb, 0, dims.height);
+    redraw = true;
+  } else if (const auto rows = fb.changed_since(uploaded_generation); !rows.empty()) {
+    upload_rows(fb, static_cast<int>(rows.first), static_cast<int>(rows.last - rows.first));
+    redraw = true;
   }
+  uploaded_generation = fb.generation();
+
+  if (!redraw) {
+    return false;
+  }
+  redraw = false;
 
   glUseProgram(shader_prog);
   glUniform4fv(background_color, 1, (GLfloat*)&background);
@@ -135,4 +154,91 @@ void renderer::render(const chip8vm* chip8) {
   glBindVertexArray(vertex_array);
   
   glDrawArrays(GL_TRIANGLES, 0, 6);
+  return true;
+}
+
+void renderer::upload_rows(const framebuffer& fb, int first, int count) {
+  const uint8_t* src = fb.data() + first * fb.stride();
+  const std::size_t size = count * fb.stride();
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (!upload_ptr) {
+    glTexSubImage2D(
+      GL_TEXTURE_2D, 0, 0, first, dims.stride, count, GL_RED_INTEGER, GL_UNSIGNED_BYTE, src);
+    return;
+  }
+
+  // this segment was last used UPLOAD_SEGMENTS uploads ago, so the wait is almost always over
+  // by now
+  GLsync& fence = upload_fences[upload_segment];
+  if (fence) {
+    const GLuint64 TIMEOUT_NS = 1000000000;
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  const std::size_t offset = upload_segment * upload_segment_size;
+  std::memcpy(upload_ptr + offset, src, size);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_buffer);
+  glTexSubImage2D(GL_TEXTURE_2D,
+    0,
+    0,
+    first,
+    dims.stride,
+    count,
+    GL_RED_INTEGER,
+    GL_UNSIGNED_BYTE,
+    reinterpret_cast<const void*>(offset));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  upload_segment = (upload_segment + 1) % UPLOAD_SEGMENTS;
+}
+
+void renderer::create_upload_ring(std::size_t segment_size) {
+  destroy_upload_ring();
+  if (!has_buffer_storage) {
+    return;
+  }
+
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const std::size_t size = segment_size * UPLOAD_SEGMENTS;
+
+  glGenBuffers(1, &upload_buffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_buffer);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+  upload_ptr = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  if (upload_ptr) {
+    upload_segment_size = segment_size;
+  } else {
+    // fall back to client memory uploads
+    destroy_upload_ring();
+    has_buffer_storage = false;
+  }
+}
+
+void renderer::destroy_upload_ring() {
+  for (GLsync& fence : upload_fences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (upload_buffer) {
+    if (upload_ptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &upload_buffer);
+  }
+  upload_buffer = 0;
+  upload_ptr = nullptr;
+  upload_segment_size = 0;
+  upload_segment = 0;
 }
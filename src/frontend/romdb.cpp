@@ -0,0 +1,161 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frontend/romdb.hpp"
+#include "frontend/config.hpp"
+#include "common/fnv1a.hpp"
+#include "common/integral_cast.hpp"
+#include <toml.hpp>
+#include <fmt/format.h>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+
+uint64_t rom_hash(const uint8_t* data, std::size_t size) {
+  return fnv1a(data, size);
+}
+
+compat_flags quirk_from_string(const std::string& name) {
+  if (name == "shift_in_place") {
+    return compat_flags::shift_in_place;
+  } else if (name == "display_wait") {
+    return compat_flags::display_wait;
+  } else {
+    throw config_error("unknown quirk in rom database", name);
+  }
+}
+
+chip8_key hexkey_from_string(const std::string& name) {
+  int value = -1;
+  if (name.size() == 1) {
+    std::from_chars(name.data(), name.data() + name.size(), value, 16);
+  }
+  if (value < 0 || !is_valid_key(static_cast<chip8_key>(value))) {
+    throw config_error("invalid hex key in rom database", name);
+  }
+  return static_cast<chip8_key>(value);
+}
+
+uint64_t hash_from_string(const std::string& str) {
+  uint64_t hash = 0;
+  auto result = std::from_chars(str.data(), str.data() + str.size(), hash, 16);
+  if (str.empty() || result.ec != std::errc{} || result.ptr != str.data() + str.size()) {
+    throw config_error("invalid hash in rom database", str);
+  }
+  return hash;
+}
+
+// settings present in n override the ones already in profile
+void load_rom_profile(const toml::value& n, rom_profile& profile) {
+  const auto& table = n.as_table();
+
+  if (table.count("cycles_per_frame")) {
+    profile.cycles_per_frame = integral_cast<int>(n.at("cycles_per_frame").as_integer());
+    if (*profile.cycles_per_frame <= 0) {
+      throw config_error("cycles_per_frame must be positive", std::to_string(*profile.cycles_per_frame));
+    }
+  }
+
+  if (table.count("quirks")) {
+    for (const auto& quirk : n.at("quirks").as_array()) {
+      profile.quirks |= quirk_from_string(quirk.as_string());
+    }
+  }
+
+  if (table.count("keys")) {
+    for (const auto& [name, key] : n.at("keys").as_table()) {
+      const std::string& keyname = key.as_string();
+      try {
+        profile.keys[to_sdl_key(keyname)] = hexkey_from_string(name);
+      } catch (const bad_key_name& e) {
+        throw config_error(e.what(), e.keyname);
+      }
+    }
+  }
+}
+
+romdb::romdb(std::string path) : _path{std::move(path)} {
+}
+
+const rom_profile* romdb::find(uint64_t hash) {
+  ensure_loaded();
+
+  if (auto it = _index.find(hash); it != _index.end()) {
+    return &it->second;
+  } else {
+    return nullptr;
+  }
+}
+
+bool romdb::save_cycles_per_frame(uint64_t hash, int cycles_per_frame) {
+  ensure_loaded();
+
+  std::ofstream file(_path, std::ios::app);
+  if (!file) {
+    return false;
+  }
+
+  file << fmt::format("\n[[rom]]\n"
+                      "# added by auto tuning\n"
+                      "hash = \"{:016x}\"\n"
+                      "cycles_per_frame = {}\n",
+    hash,
+    cycles_per_frame);
+
+  if (!file) {
+    return false;
+  }
+
+  _index[hash].cycles_per_frame = cycles_per_frame;
+  return true;
+}
+
+void romdb::ensure_loaded() {
+  if (!_loaded) {
+    // only try once; a broken database shouldn't produce an error for every rom loaded
+    _loaded = true;
+    load();
+  }
+}
+
+void romdb::load() {
+  // having no database is fine, it just means no rom has custom settings
+  if (!std::filesystem::exists(_path)) {
+    return;
+  }
+
+  toml::value data;
+  try {
+    data = toml::parse(_path);
+  } catch (const toml::syntax_error& e) {
+    throw config_error("syntax error in rom database", e.what());
+  }
+
+  try {
+    if (!data.as_table().count("rom")) {
+      return;
+    }
+    // settings in later entries override earlier ones with the same hash
+    for (const auto& entry : data.at("rom").as_array()) {
+      uint64_t hash = hash_from_string(entry.at("hash").as_string());
+      load_rom_profile(entry, _index[hash]);
+    }
+  } catch (const toml::type_error& e) {
+    throw config_error("rom database setting has an incorrect type", e.what());
+  } catch (const bad_integral_cast& e) {
+    throw config_error("rom database setting is out of range", e.what());
+  } catch (const std::out_of_range& e) {
+    throw config_error("rom database entry is missing a hash", e.what());
+  }
+}
@@ -15,7 +15,10 @@
 #include "frontend/romio.hpp"
 #include "emu/vm.hpp"
 #include "asm/compiler.hpp"
+#include "asm/incremental.hpp"
+#include "asm/module.hpp"
 #include <fstream>
+#include <iterator>
 #include <cstring>
 
 const char* getext(const char* filename) {
@@ -31,7 +34,7 @@ const char* getext(const char* filename) {
   }
 }
 
-bool load_rom_from_disk(chip8vm& state, const char* filename) {
+bool load_rom_from_disk(chip8vm& state, const char* filename, std::size_t& program_size) {
   std::ifstream file(filename, std::ios::binary);
 
   if (!file) {
@@ -39,10 +42,10 @@ bool load_rom_from_disk(chip8vm& state, const char* filename) {
   }
 
   file.seekg(0, std::ios::end);
-  const auto program_size = file.tellg();
+  const auto file_size = file.tellg();
   file.seekg(0);
 
-  if (static_cast<size_t>(program_size) > chip8vm::PROGRAM_MAX_SIZE) {
+  if (static_cast<size_t>(file_size) > chip8vm::PROGRAM_MAX_SIZE) {
     return false;
   }
 
@@ -50,6 +53,7 @@ bool load_rom_from_disk(chip8vm& state, const char* filename) {
   uint8_t* program_ptr = &state.memory[chip8vm::PROGRAM_START];
   file.read(reinterpret_cast<char*>(program_ptr), chip8vm::PROGRAM_MAX_SIZE);
 
+  program_size = static_cast<size_t>(file_size);
   return true;
 }
 
@@ -64,7 +68,7 @@ bool load_rom_from_memory(chip8vm& state, const uint8_t* data, std::size_t size)
   return true;
 }
 
-bool load_file(chip8vm& state, const char* filename) {
+bool load_file(chip8vm& state, const char* filename, std::size_t& program_size) {
   const char* ext = getext(filename);
 
   if (!ext) {
@@ -72,27 +76,67 @@ bool load_file(chip8vm& state, const char* filename) {
   }
 
   if (strcmp(ext, ".ch8") == 0) {
-    return load_rom_from_disk(state, filename);
+    return load_rom_from_disk(state, filename, program_size);
   } else if (strcmp(ext, ".c8s") == 0) {
-    std::ifstream file(filename, std::ios::binary);
+    std::string source;
 
-    if (!file) {
+    if (!read_source(filename, source)) {
       return false;
     }
 
-    file.seekg(0, std::ios::end);
-    std::streamsize program_size = file.tellg();
-    file.seekg(0);
+    if (has_includes(source)) {
+      module_options options;
+      options.root_source = &source;
+      const std::vector<uint8_t> program = assemble_modules(filename, options);
+      program_size = program.size();
+      return load_rom_from_memory(state, program.data(), program.size());
+    }
 
-    std::string program_src;
-    program_src.resize(program_size, 0);
+    uint8_t* program_ptr = &state.memory[chip8vm::PROGRAM_START];
+    return compile_into(source, program_ptr, chip8vm::PROGRAM_MAX_SIZE, program_size);
+  } else {
+    return false;
+  }
+}
 
-    file.read(program_src.data(), program_size);
+bool read_source(const char* filename, std::string& contents) {
+  std::ifstream file(filename, std::ios::binary);
 
-    auto program = compile(program_src.c_str());
+  if (!file) {
+    return false;
+  }
 
-    return load_rom_from_memory(state, program.data(), program.size());
-  } else {
+  // a file that shrinks in the meantime just reads short
+  contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+bool is_source_file(const char* filename) {
+  const char* ext = getext(filename);
+  return ext && strcmp(ext, ".c8s") == 0;
+}
+
+bool load_source(chip8vm& state, const char* filename,
+  std::unique_ptr<incremental_assembler>& assembler, std::size_t& program_size) {
+  std::string source;
+
+  if (!read_source(filename, source)) {
     return false;
   }
-}
\ No newline at end of file
+
+  if (has_includes(source)) {
+    assembler.reset();
+    module_options options;
+    options.root_source = &source;
+    const std::vector<uint8_t> program = assemble_modules(filename, options);
+    program_size = program.size();
+    return load_rom_from_memory(state, program.data(), program_size);
+  }
+
+  // the assembler compares later versions of the file against this copy
+  assembler = std::make_unique<incremental_assembler>();
+  assembler->assemble(std::move(source));
+
+  program_size = assembler->bytes().size();
+  return load_rom_from_memory(state, assembler->bytes().data(), program_size);
+}
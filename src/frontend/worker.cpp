@@ -0,0 +1,75 @@
+// Copyright 2019 J.C. Moyer
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frontend/worker.hpp"
+#include <SDL.h>
+#include <memory>
+
+static Uint32 main_thread_call_event() {
+  static const Uint32 type = SDL_RegisterEvents(1);
+  return type;
+}
+
+void call_on_main_thread(std::function<void()> fn) {
+  SDL_Event ev{};
+  ev.type = main_thread_call_event();
+  ev.user.data1 = new std::function<void()>(std::move(fn));
+  if (SDL_PushEvent(&ev) != 1) {
+    delete static_cast<std::function<void()>*>(ev.user.data1);
+  }
+}
+
+bool run_main_thread_call(const SDL_Event& ev) {
+  if (ev.type != main_thread_call_event())
+    return false;
+  std::unique_ptr<std::function<void()>> fn{static_cast<std::function<void()>*>(ev.user.data1)};
+  (*fn)();
+  return true;
+}
+
+worker::worker() : _thread{&worker::thread_main, this} {
+}
+
+worker::~worker() {
+  {
+    std::lock_guard lock{_mutex};
+    _quit = true;
+  }
+  _wake.notify_one();
+  _thread.join();
+}
+
+void worker::post(job j) {
+  {
+    std::lock_guard lock{_mutex};
+    _jobs.push_back(std::move(j));
+  }
+  _wake.notify_one();
+}
+
+void worker::thread_main() {
+  for (;;) {
+    job next;
+    {
+      std::unique_lock lock{_mutex};
+      _wake.wait(lock, [this]() { return _quit || !_jobs.empty(); });
+      if (_quit)
+        return;
+      next = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+    if (completion done = next())
+      call_on_main_thread(std::move(done));
+  }
+}
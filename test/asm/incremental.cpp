@@ -0,0 +1,138 @@
+#include <catch.hpp>
+#include "asm/compiler.hpp"
+#include "asm/incremental.hpp"
+#include <random>
+#include <string>
+
+static std::string make_source(int blocks) {
+  std::string source;
+  for (int i = 0; i < blocks; ++i) {
+    const std::string n = std::to_string(i);
+    source += "l" + n + ":\n  ld v1, " + std::to_string(i % 256) + "\n  call l" +
+              std::to_string(blocks - 1 - i) + " ; comment\n";
+    if (i % 7 == 0)
+      source += "d" + n + ": data 1, 2, " + std::to_string(i % 256) + "\n";
+  }
+  return source;
+}
+
+// applies changes to before and checks that gives after
+static void check_patch(std::vector<uint8_t> before, const std::vector<uint8_t>& after,
+  const std::vector<byte_range>& changes) {
+  before.resize(std::max(before.size(), after.size()));
+  for (const byte_range& r : changes) {
+    for (std::size_t i = r.offset; i < r.offset + r.size; ++i)
+      before[i] = i < after.size() ? after[i] : 0;
+  }
+  before.resize(after.size());
+  REQUIRE(before == after);
+}
+
+TEST_CASE("incremental update matches full assembly") {
+  std::string source = make_source(500);
+  incremental_assembler assembler;
+  assembler.assemble(source);
+  REQUIRE(assembler.bytes() == compile(source));
+
+  SECTION("operand change") {
+    const auto before = assembler.bytes();
+    const std::size_t at = source.find("ld v1, 200");
+    source.replace(at, 10, "ld v1, 201");
+    const auto changes = assembler.update(source);
+    REQUIRE(assembler.bytes() == compile(source));
+    REQUIRE(assembler.parsed_statements() < 8);
+    REQUIRE(changes.size() == 1);
+    REQUIRE(changes[0].size == 2);
+    check_patch(before, assembler.bytes(), changes);
+  }
+
+  SECTION("inserted instruction moves later labels") {
+    const auto before = assembler.bytes();
+    source.insert(source.find("l250:"), "cls\n");
+    const auto changes = assembler.update(source);
+    REQUIRE(assembler.bytes() == compile(source));
+    REQUIRE(assembler.parsed_statements() < 8);
+    check_patch(before, assembler.bytes(), changes);
+  }
+
+  SECTION("unchanged source") {
+    REQUIRE(assembler.update(source).empty());
+  }
+}
+
+TEST_CASE("incremental update errors") {
+  std::string source = "start:\ncls\njmp start\nend:\njmp end\n";
+  incremental_assembler assembler;
+  assembler.assemble(source);
+  const auto good = assembler.bytes();
+
+  SECTION("undefined label") {
+    try {
+      assembler.update("start:\ncls\njmp start\nfin:\njmp end\n");
+      FAIL("expected syntax_error");
+    } catch (const syntax_error& e) {
+      REQUIRE(std::string(e.what()) == "undefined label");
+      REQUIRE(e.line == 5);
+      REQUIRE(e.context == "end");
+    }
+    REQUIRE(assembler.bytes() == good);
+  }
+
+  SECTION("duplicate label") {
+    REQUIRE_THROWS_AS(assembler.update("start:\ncls\nstart:\njmp start\nend:\njmp end\n"),
+      syntax_error);
+    REQUIRE(assembler.bytes() == good);
+  }
+
+  SECTION("joined tokens") {
+    REQUIRE_THROWS_AS(assembler.update("start:\nclsjmp start\nend:\njmp end\n"), syntax_error);
+  }
+
+  // recovers after an error
+  const std::string fixed = "start:\ncls\ncls\njmp start\nend:\njmp end\n";
+  const auto changes = assembler.update(fixed);
+  REQUIRE(assembler.bytes() == compile(fixed));
+  check_patch(good, assembler.bytes(), changes);
+}
+
+TEST_CASE("random edits") {
+  std::mt19937 rng(1234);
+  const char* fragments[] = {"\n", " ", ",", ":", ";", "cls\n", "ret", "ld v2, 3\n", "jmp l3\n",
+    "l3", "l", "x:", "data 5\n", "v", "9", "0x", "call l1\n"};
+
+  std::string source = make_source(20);
+  incremental_assembler assembler;
+  assembler.assemble(source);
+  std::vector<uint8_t> last_good = assembler.bytes();
+
+  for (int edit = 0; edit < 2000; ++edit) {
+    std::string next = source;
+    std::uniform_int_distribution<std::size_t> pos_dist(0, next.size());
+    const std::size_t pos = pos_dist(rng);
+    if (rng() % 2 && pos < next.size()) {
+      next.erase(pos, 1 + rng() % 4);
+    } else {
+      next.insert(pos, fragments[rng() % std::size(fragments)]);
+    }
+
+    std::vector<uint8_t> expected;
+    bool valid = true;
+    try {
+      expected = compile(next);
+    } catch (const syntax_error&) {
+      valid = false;
+    }
+
+    if (valid) {
+      const auto changes = assembler.update(next);
+      REQUIRE(assembler.bytes() == expected);
+      check_patch(last_good, expected, changes);
+      last_good = expected;
+      source = next;
+    } else {
+      REQUIRE_THROWS_AS(assembler.update(next), syntax_error);
+      REQUIRE(assembler.bytes() == last_good);
+      // keep editing the last source that assembled, like someone fixing their typo
+    }
+  }
+}
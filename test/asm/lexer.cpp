@@ -0,0 +1,113 @@
+#include <catch.hpp>
+#include "asm/lexer.hpp"
+
+TEST_CASE("lexer keywords") {
+  lexer lex("ld i dt st va jmp0 jmp jmpx hires data");
+
+  const auto expect = [&](token_type type, std::string_view span) {
+    lex.next();
+    REQUIRE(lex.current().type == type);
+    REQUIRE(lex.current().span == span);
+    return lex.current();
+  };
+
+  token ld = expect(token_type::mnemonic, "ld");
+  REQUIRE(ld.mnemonic == opmetas.mnemonic_id("ld"));
+  expect(token_type::i, "i");
+  expect(token_type::dt, "dt");
+  expect(token_type::st, "st");
+  REQUIRE(expect(token_type::variable, "va").numeric_value == 0xA);
+  REQUIRE(expect(token_type::mnemonic, "jmp0").mnemonic == opmetas.mnemonic_id("jmp0"));
+  REQUIRE(expect(token_type::mnemonic, "jmp").mnemonic == opmetas.mnemonic_id("jmp"));
+  REQUIRE(expect(token_type::text, "jmpx").mnemonic == -1);
+  expect(token_type::mnemonic, "hires");
+  expect(token_type::text, "data");
+  expect(token_type::eos, "");
+}
+
+TEST_CASE("every mnemonic is recognized") {
+  for (std::size_t id = 0; id < opmetas.mnemonic_count(); ++id) {
+    const std::string_view name = opmetas.mnemonic_name(static_cast<int>(id));
+    lexer lex{name};
+    lex.next();
+    REQUIRE(lex.current().type == token_type::mnemonic);
+    REQUIRE(lex.current().mnemonic == static_cast<int>(id));
+  }
+}
+
+TEST_CASE("lexing stops at the end of the view") {
+  // the view is not NUL terminated; the lexer must not read past it
+  const char source[] = {'c', 'l', 's', '\n', 'r', 'e', 't'};
+
+  lexer lex(std::string_view(source, 5));
+  lex.next();
+  REQUIRE(lex.current().span == "cls");
+  lex.next();
+  REQUIRE(lex.current().type == token_type::text);
+  REQUIRE(lex.current().span == "r");
+  lex.next();
+  REQUIRE(lex.current().type == token_type::eos);
+}
+
+TEST_CASE("comment at end of source") {
+  const char source[] = {'c', 'l', 's', ' ', ';', 'x', 'y'};
+
+  lexer lex(std::string_view(source, sizeof(source)));
+  lex.next();
+  REQUIRE(lex.current().type == token_type::mnemonic);
+  lex.next();
+  REQUIRE(lex.current().type == token_type::eos);
+}
+
+TEST_CASE("number at end of source") {
+  const char source[] = {'0', 'x', '1', 'f', 'f'};
+
+  lexer lex(std::string_view(source, 4));
+  lex.next();
+  REQUIRE(lex.current().type == token_type::number);
+  REQUIRE(lex.current().numeric_value == 0x1f);
+}
+
+TEST_CASE("long runs and columns") {
+  // runs longer than any vector width, ending at every alignment
+  for (std::size_t n = 1; n < 80; ++n) {
+    const std::string name(n, 'a');
+    const std::string source = std::string(n, ' ') + name + "\t;" + std::string(n, '-') +
+                               "\r\n" + std::string(n, '\t') + "0x" + std::string(n, 'f') +
+                               "," + std::string(n, '1');
+    lexer lex(source);
+
+    lex.next();
+    REQUIRE(lex.current().span == name);
+    REQUIRE(lex.current().location.line == 1);
+    REQUIRE(lex.current().location.pos == static_cast<int>(n) + 1);
+
+    lex.next();
+    REQUIRE(lex.current().type == token_type::number);
+    REQUIRE(lex.current().span == std::string(n, 'f'));
+    REQUIRE(lex.current().location.line == 2);
+    REQUIRE(lex.current().location.pos == static_cast<int>(n) + 1);
+
+    lex.next();
+    REQUIRE(lex.current().type == token_type::comma);
+    REQUIRE(lex.current().location.pos == 2 * static_cast<int>(n) + 3);
+
+    lex.next();
+    REQUIRE(lex.current().span == std::string(n, '1'));
+    lex.next();
+    REQUIRE(lex.current().type == token_type::eos);
+  }
+}
+
+TEST_CASE("invalid character position") {
+  lexer lex("cls\n  ret ?");
+  lex.next();
+  lex.next();
+  try {
+    lex.next();
+    FAIL("expected syntax_error");
+  } catch (const syntax_error& e) {
+    REQUIRE(e.line == 2);
+    REQUIRE(e.pos == 7);
+  }
+}
@@ -0,0 +1,148 @@
+#include <catch.hpp>
+#include "asm/compiler.hpp"
+#include "asm/error.hpp"
+#include "asm/linker.hpp"
+#include "asm/module.hpp"
+#include "asm/object.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& path, const std::string& contents) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(contents.data(), contents.size());
+}
+
+TEST_CASE("single object links to the same program as compile") {
+  const char* source = "start:\n  ld i, sprite\n  call draw\n  jmp start\n"
+                       "draw:\n  disp v0, v1, 1\n  ret\nsprite: data 0xFF\n";
+  const object_file object = assemble_object(source);
+  REQUIRE(object.relocations.size() == 3);
+  REQUIRE(link({{"main", &object}}) == compile(source));
+}
+
+TEST_CASE("objects resolve each other's labels") {
+  const object_file main = assemble_object("include util\nloop:\n  call draw\n  jmp loop\n");
+  const object_file util = assemble_object("draw:\n  cls\n  ret\n");
+  REQUIRE(main.includes.size() == 1);
+  REQUIRE(main.includes[0].name == "util");
+
+  const std::vector<uint8_t> program = link({{"main", &main}, {"util", &util}});
+  // draw lands right after main's 4 bytes, at 0x204
+  REQUIRE(program == std::vector<uint8_t>{0x22, 0x04, 0x12, 0x00, 0x00, 0xE0, 0x00, 0xEE});
+}
+
+TEST_CASE("link errors") {
+  const object_file a = assemble_object("here:\n  jmp there\n");
+  REQUIRE_THROWS_AS(link({{"a", &a}}), link_error);
+  try {
+    link({{"a", &a}});
+  } catch (const link_error& e) {
+    REQUIRE(e.symbol == "there");
+    REQUIRE(e.file == "a");
+    REQUIRE(e.line == 2);
+  }
+
+  const object_file b = assemble_object("here:\n  cls\n");
+  REQUIRE_THROWS_AS(link({{"a", &a}, {"b", &b}}), link_error);
+}
+
+TEST_CASE("object encoding round trips") {
+  const object_file object =
+    assemble_object("include other\nstart:\n  ld i, table\n  jmp start\ntable: data 1, 2, 3\n");
+  std::vector<uint8_t> bytes;
+  write_object(bytes, object, 1234);
+
+  object_file copy;
+  REQUIRE(read_object(bytes.data(), bytes.size(), 1234, copy));
+  REQUIRE(copy.code == object.code);
+  REQUIRE(copy.symbols.size() == object.symbols.size());
+  REQUIRE(copy.relocations.size() == object.relocations.size());
+  REQUIRE(copy.relocations[0].symbol == "table");
+  REQUIRE(copy.includes.size() == 1);
+  REQUIRE(copy.includes[0].name == "other");
+  REQUIRE(link({{"x", &copy}}) == link({{"x", &object}}));
+
+  // a different source, or a truncated object, is rejected
+  REQUIRE(!read_object(bytes.data(), bytes.size(), 4321, copy));
+  for (std::size_t size = 0; size < bytes.size(); ++size)
+    REQUIRE(!read_object(bytes.data(), size, 1234, copy));
+}
+
+TEST_CASE("modules are assembled from disk and cached") {
+  const fs::path dir = fs::path("linker_test.tmp");
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  write_file(dir / "main.c8s", "include gfx\ninclude sound\nloop:\n  call draw\n"
+                               "  call beep\n  jmp loop\n");
+  write_file(dir / "gfx.c8s", "include sound\ndraw:\n  cls\n  ret\n");
+  write_file(dir / "sound.c8s", "beep:\n  ld v0, 10\n  ld st, v0\n  ret\n");
+
+  module_options options;
+  options.cache_dir = (dir / "cache").string();
+  const std::string root = (dir / "main.c8s").string();
+  const std::vector<uint8_t> expected = compile("loop:\n  call draw\n  call beep\n  jmp loop\n"
+                                                "draw:\n  cls\n  ret\n"
+                                                "beep:\n  ld v0, 10\n  ld st, v0\n  ret\n");
+
+  module_stats first;
+  REQUIRE(assemble_modules(root, options, &first) == expected);
+  // sound is included twice but only linked once
+  REQUIRE(first.assembled == 3);
+  REQUIRE(first.cached == 0);
+
+  module_stats second;
+  REQUIRE(assemble_modules(root, options, &second) == expected);
+  REQUIRE(second.assembled == 0);
+  REQUIRE(second.cached == 3);
+
+  write_file(dir / "gfx.c8s", "include sound\ndraw:\n  hires\n  ret\n");
+  module_stats third;
+  std::vector<uint8_t> changed = expected;
+  changed[6] = 0x00;
+  changed[7] = 0xFF;
+  REQUIRE(assemble_modules(root, options, &third) == changed);
+  REQUIRE(third.assembled == 1);
+  REQUIRE(third.cached == 2);
+
+  SECTION("root source already read by the caller") {
+    // main.c8s on disk is ignored
+    const std::string source = "include sound\nstart:\n  call beep\n  jmp start\n";
+    options.root_source = &source;
+    REQUIRE(assemble_modules(root, options) ==
+            compile("start:\n  call beep\n  jmp start\nbeep:\n  ld v0, 10\n  ld st, v0\n  ret\n"));
+  }
+
+  SECTION("errors name the file they are in") {
+    write_file(dir / "sound.c8s", "beep:\n  ld v0,\n");
+    try {
+      assemble_modules(root, options);
+      FAIL("expected a syntax error");
+    } catch (const syntax_error& e) {
+      REQUIRE(fs::path(e.file) == dir / "sound.c8s");
+    }
+  }
+
+  SECTION("missing module") {
+    write_file(dir / "gfx.c8s", "include missing\ndraw:\n  ret\n");
+    try {
+      assemble_modules(root, options);
+      FAIL("expected a syntax error");
+    } catch (const syntax_error& e) {
+      REQUIRE(e.context == "missing");
+      REQUIRE(e.line == 1);
+    }
+  }
+
+  fs::remove_all(dir);
+}
+
+TEST_CASE("include outside of a module build") {
+  REQUIRE(has_includes("include gfx\ncls\n"));
+  // include is only special at the start of a statement
+  REQUIRE(!has_includes("jmp include\ndraw: cls\n"));
+  REQUIRE(!has_includes("include:\n  jmp include\n"));
+  REQUIRE_THROWS_AS(compile("include gfx\ncls\n"), syntax_error);
+}
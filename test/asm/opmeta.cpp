@@ -0,0 +1,65 @@
+#include <catch.hpp>
+#include "asm/opmeta.hpp"
+
+static_assert(opmetas.is_mnemonic("jmp"));
+static_assert(!opmetas.is_mnemonic("jump"));
+static_assert(opmetas.find_signature({"ld", operand_type::v, operand_type::dt})->opcode == 0xF007);
+static_assert(!opmetas.find_signature({"ld", operand_type::dt, operand_type::dt}));
+
+TEST_CASE("find_opcode") {
+  const opmetatable& tbl = opmetas;
+
+  SECTION("operands are ignored") {
+    const opmeta* m = tbl.find_opcode(0x8AB4);
+    REQUIRE(m);
+    REQUIRE(m->mnemonic == "add");
+    REQUIRE(m->a == operand_type::v);
+    REQUIRE(m->b == operand_type::v);
+
+    REQUIRE(tbl.find_opcode(0xDABC) == tbl.find_opcode(0xD000));
+    REQUIRE(tbl.find_opcode(0xF165) == tbl.find_opcode(0xF065));
+  }
+
+  SECTION("system instructions match exactly") {
+    REQUIRE(tbl.find_opcode(0x00E0)->mnemonic == "cls");
+    REQUIRE(tbl.find_opcode(0x00EE)->mnemonic == "ret");
+    REQUIRE(tbl.find_opcode(0x00FF)->mnemonic == "hires");
+    REQUIRE(!tbl.find_opcode(0x00E1));
+    REQUIRE(!tbl.find_opcode(0x0123));
+  }
+
+  SECTION("first signature wins when opcodes are shared") {
+    const opmeta* m = tbl.find_opcode(0xA123);
+    REQUIRE(m);
+    REQUIRE(m->mnemonic == "ld");
+    REQUIRE(m->a == operand_type::i);
+    REQUIRE(m->b == operand_type::k);
+  }
+
+  SECTION("unknown opcodes") {
+    REQUIRE(!tbl.find_opcode(0x5AB1));
+    REQUIRE(!tbl.find_opcode(0x8AB8));
+    REQUIRE(!tbl.find_opcode(0xE19F));
+    REQUIRE(!tbl.find_opcode(0xF0FF));
+  }
+
+  SECTION("every result has the stripped opcode") {
+    for (uint32_t opcode = 0; opcode <= 0xFFFF; ++opcode) {
+      const opmeta* m = tbl.find_opcode(static_cast<uint16_t>(opcode));
+      if (m) {
+        REQUIRE((opcode & m->opcode) == m->opcode);
+      }
+    }
+  }
+}
+
+TEST_CASE("get_signatures") {
+  int count = 0;
+  for (const opmeta& m : opmetas.get_signatures("ld")) {
+    REQUIRE(m.mnemonic == "ld");
+    ++count;
+  }
+  REQUIRE(count == 7);
+  REQUIRE(opmetas.get_signatures("cls").begin()->opcode == 0x00E0);
+  REQUIRE(opmetas.get_signatures("nop").empty());
+}
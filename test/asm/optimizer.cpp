@@ -0,0 +1,151 @@
+#include <catch.hpp>
+#include "asm/compiler.hpp"
+#include "asm/lexer.hpp"
+#include "asm/optimizer.hpp"
+#include "asm/parser.hpp"
+#include "emu/vm.hpp"
+#include <algorithm>
+#include <memory>
+
+struct optimized_program {
+  std::vector<uint8_t> bytes;
+  optimizer_stats stats;
+};
+
+static optimized_program optimize(const char* source) {
+  lexer l(source);
+  parser p(l);
+  while (!p.at_end())
+    p.parse_statement();
+  optimized_program result;
+  result.stats = p.optimize();
+  write_program(result.bytes, p.parse_program());
+  return result;
+}
+
+// runs program until it reaches the `done: jmp done` it ends with
+static std::unique_ptr<chip8vm> run(const std::vector<uint8_t>& program) {
+  auto vm = std::make_unique<chip8vm>();
+  std::copy(program.begin(), program.end(), vm->memory.begin() + chip8vm::PROGRAM_START);
+  const uint16_t done = static_cast<uint16_t>(chip8vm::PROGRAM_START + program.size() - 2);
+  for (int i = 0; i < 10000 && vm->pc != done; ++i)
+    vm->step();
+  REQUIRE(vm->pc == done);
+  return vm;
+}
+
+TEST_CASE("jump threading") {
+  const auto result = optimize("start:\n  jmp a\na:\n  jmp b\nb:\n  call c\n  jmp start\n"
+                               "c:\n  jmp d\nd:\n  ret\n");
+  REQUIRE(result.stats.jumps_threaded == 3);
+  // start jumps straight to b, b calls d, and the jump back to start goes to b too
+  const std::vector<uint8_t> expected{
+    0x12, 0x04, 0x12, 0x04, 0x22, 0x0A, 0x12, 0x04, 0x12, 0x0A, 0x00, 0xEE};
+  REQUIRE(result.bytes == expected);
+}
+
+TEST_CASE("jump cycles terminate") {
+  const auto result = optimize("a:\n  jmp b\nb:\n  jmp a\n");
+  REQUIRE(result.bytes.size() == 4);
+}
+
+TEST_CASE("tail calls") {
+  const auto result = optimize("main:\n  call f\n  ret\nf:\n  cls\n  ret\n");
+  REQUIRE(result.stats.tail_calls == 1);
+  // the ret after the call can no longer be reached
+  REQUIRE(result.stats.dead_removed == 1);
+  REQUIRE(result.bytes == compile("main:\n  jmp f\nf:\n  cls\n  ret\n"));
+}
+
+TEST_CASE("dead code") {
+  SECTION("removed up to the next label") {
+    const auto result = optimize("jmp end\ncls\nld v0, 1\nend:\n  ret\n");
+    REQUIRE(result.stats.dead_removed == 2);
+    REQUIRE(result.bytes == compile("jmp end\nend:\n  ret\n"));
+  }
+
+  SECTION("a skipped jump keeps what follows") {
+    const auto result = optimize("skeq v0, 1\njmp end\ncls\nend:\n  ret\n");
+    REQUIRE(result.stats.dead_removed == 0);
+  }
+
+  SECTION("data and jump tables are kept") {
+    const char* source = "jmp0 table\ntable:\n  jmp a\n  jmp b\na:\n  ret\nb:\n  jmp a\n"
+                         "  data 1, 2\n";
+    const auto result = optimize(source);
+    REQUIRE(result.stats.removed() == 0);
+    REQUIRE(result.bytes == compile(source));
+  }
+}
+
+TEST_CASE("numeric addresses keep the layout") {
+  const char* source = "ld i, 0x20A\njmp start\ncls\nld v0, 1\n"
+                       "start:\n  jmp start\ndata 0xAA\n";
+  const auto result = optimize(source);
+  REQUIRE(result.stats.removed() == 0);
+  REQUIRE(result.bytes == compile(source));
+  // the data ld i points at is still there
+  REQUIRE(result.bytes[0x20A - chip8vm::PROGRAM_START] == 0xAA);
+}
+
+TEST_CASE("redundant loads") {
+  SECTION("same value") {
+    const auto result = optimize("ld v0, 5\nld v1, v0\nld v0, 5\nld v1, 5\ncls\nld v0, 5\n");
+    REQUIRE(result.stats.loads_removed == 3);
+    REQUIRE(result.bytes == compile("ld v0, 5\nld v1, v0\ncls\n"));
+  }
+
+  SECTION("writes and labels forget values") {
+    const char* source = "ld v0, 5\nadd v0, 1\nld v0, 5\nld vf, 0\nadd v1, v2\nld vf, 0\n"
+                         "ld v3, 1\nl:\n  ld v3, 1\nld v4, 2\ncall l\nld v4, 2\n";
+    const auto result = optimize(source);
+    REQUIRE(result.stats.loads_removed == 0);
+  }
+
+  SECTION("instructions after a skip are kept") {
+    const char* source = "ld v0, 5\nskeq v1, 1\nld v0, 5\nld v0, 5\n";
+    const auto result = optimize(source);
+    REQUIRE(result.stats.loads_removed == 1);
+    REQUIRE(result.bytes == compile("ld v0, 5\nskeq v1, 1\nld v0, 5\n"));
+  }
+}
+
+TEST_CASE("optimized program behaves the same") {
+  const char* source = "  ld v0, 0\n"
+                       "  ld v1, 0\n"
+                       "loop:\n"
+                       "  ld v2, 3\n"
+                       "  ld v2, 3\n"
+                       "  call step\n"
+                       "  skeq v0, 10\n"
+                       "  jmp loop\n"
+                       "  jmp finish\n"
+                       "  cls\n"
+                       "step:\n"
+                       "  add v0, 1\n"
+                       "  add v1, v2\n"
+                       "  call bump\n"
+                       "  ret\n"
+                       "bump:\n"
+                       "  ld i, scratch\n"
+                       "  ld v3, 7\n"
+                       "  ld v3, 7\n"
+                       "  store v3\n"
+                       "  ret\n"
+                       "finish:\n"
+                       "  jmp done\n"
+                       "scratch:\n"
+                       "  data 0, 0, 0, 0\n"
+                       "done:\n"
+                       "  jmp done\n";
+  const std::vector<uint8_t> plain = compile(source);
+  const auto optimized = optimize(source);
+  REQUIRE(optimized.stats.removed() > 0);
+  REQUIRE(optimized.bytes.size() < plain.size());
+
+  const auto expected = run(plain);
+  const auto actual = run(optimized.bytes);
+  REQUIRE(actual->variables == expected->variables);
+  REQUIRE(actual->callstack.empty());
+  REQUIRE(expected->callstack.empty());
+}
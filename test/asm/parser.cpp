@@ -0,0 +1,123 @@
+#include <catch.hpp>
+#include "asm/lexer.hpp"
+#include "asm/parser.hpp"
+#include "asm/compiler.hpp"
+#include <array>
+#include <sstream>
+
+static ir_program parse_program(const char* source) {
+  lexer lex(source);
+  parser p(lex);
+  return p.parse_program();
+}
+
+static std::vector<ir_instruction> parse(const char* source) {
+  return parse_program(source).instructions;
+}
+
+TEST_CASE("labels resolve to addresses") {
+  const auto instrs = parse("jmp end\n"
+                            "start:\n"
+                            "  ld va, 1\n"
+                            "  call start\n"
+                            "end:\n"
+                            "  jmp end\n");
+  REQUIRE(instrs.size() == 4);
+  REQUIRE(instrs[0].a == 0x206);
+  REQUIRE(instrs[2].a == 0x202);
+  REQUIRE(instrs[3].a == 0x206);
+}
+
+TEST_CASE("label after data and at end of source") {
+  const auto instrs = parse("ld i, sprite\n"
+                            "jmp done\n"
+                            "sprite:\n"
+                            "data 1, 2, 3\n"
+                            "done:\n");
+  REQUIRE(instrs[0].b == 0x204);
+  REQUIRE(instrs[1].a == 0x207);
+}
+
+TEST_CASE("duplicate label") {
+  try {
+    parse("a:\ncls\n\na:\nret\n");
+    FAIL("expected syntax_error");
+  } catch (const syntax_error& e) {
+    REQUIRE(std::string(e.what()) == "duplicate label");
+    REQUIRE(e.line == 4);
+    REQUIRE(e.context == "a");
+  }
+}
+
+TEST_CASE("undefined label") {
+  try {
+    parse("cls\njmp nowhere\n");
+    FAIL("expected syntax_error");
+  } catch (const syntax_error& e) {
+    REQUIRE(std::string(e.what()) == "undefined label");
+    REQUIRE(e.line == 2);
+    REQUIRE(e.context == "nowhere");
+  }
+}
+
+TEST_CASE("many labels") {
+  std::string source;
+  for (int i = 0; i < 20000; ++i) {
+    source += "l" + std::to_string(i) + ":\njmp l" + std::to_string(19999 - i) + "\n";
+  }
+  const auto instrs = parse(source.c_str());
+  REQUIRE(instrs.size() == 20000);
+  REQUIRE(instrs.front().a == 0x200 + 2 * 19999);
+  REQUIRE(instrs.back().a == 0x200);
+}
+
+TEST_CASE("data payloads share one pool") {
+  const ir_program program = parse_program("data 1, 2\n"
+                                           "cls\n"
+                                           "data 3\n");
+  REQUIRE(program.data == std::vector<uint8_t>{1, 2, 3});
+  REQUIRE(program.size() == 5);
+
+  const ir_instruction& first = program.instructions[0];
+  const ir_instruction& second = program.instructions[2];
+  REQUIRE(first.is_data());
+  REQUIRE(!program.instructions[1].is_data());
+  REQUIRE(second.is_data());
+  REQUIRE(first.size() == 2);
+  REQUIRE(second.size() == 1);
+  REQUIRE(program.payload(second)[0] == 3);
+  REQUIRE(second.address == 0x204);
+
+  std::vector<uint8_t> bytes;
+  write_program(bytes, program);
+  REQUIRE(bytes == std::vector<uint8_t>{1, 2, 0x00, 0xE0, 3});
+}
+
+TEST_CASE("too many operands") {
+  REQUIRE_THROWS_AS(parse("disp v0, v1, 2, 3\n"), syntax_error);
+}
+
+TEST_CASE("program outputs agree") {
+  const char* source = "start: ld v0, 0x12\n"
+                       "data 7, 8, 9\n"
+                       "jmp start\n";
+  const std::vector<uint8_t> expected{0x60, 0x12, 7, 8, 9, 0x12, 0x00};
+  REQUIRE(compile(source) == expected);
+
+  std::ostringstream stream;
+  write_program(stream, parse_program(source));
+  const std::string written = stream.str();
+  REQUIRE(std::vector<uint8_t>(written.begin(), written.end()) == expected);
+
+  std::array<uint8_t, 8> memory{};
+  std::size_t size = 0;
+  REQUIRE(compile_into(source, memory.data(), memory.size(), size));
+  REQUIRE(size == expected.size());
+  REQUIRE(std::equal(expected.begin(), expected.end(), memory.begin()));
+  REQUIRE(memory[7] == 0);
+
+  // too large: nothing is written
+  std::array<uint8_t, 6> small{};
+  REQUIRE(!compile_into(source, small.data(), small.size(), size));
+  REQUIRE(small == std::array<uint8_t, 6>{});
+}
@@ -0,0 +1,20 @@
+#include "common/fnv1a.hpp"
+#include <catch.hpp>
+#include <cstdint>
+#include <cstring>
+
+std::uint64_t fnv1a_str(const char* s) {
+  return fnv1a(reinterpret_cast<const std::uint8_t*>(s), std::strlen(s));
+}
+
+TEST_CASE("fnv1a") {
+  REQUIRE(fnv1a_str("") == 0xcbf29ce484222325);
+  REQUIRE(fnv1a_str("a") == 0xaf63dc4c8601ec8c);
+  REQUIRE(fnv1a_str("foobar") == 0x85944171f73967e8);
+
+  SECTION("incremental") {
+    const auto* foo = reinterpret_cast<const std::uint8_t*>("foo");
+    const auto* bar = reinterpret_cast<const std::uint8_t*>("bar");
+    REQUIRE(fnv1a(bar, 3, fnv1a(foo, 3)) == fnv1a_str("foobar"));
+  }
+}
@@ -0,0 +1,42 @@
+#include "common/mapped_file.hpp"
+#include <catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+static void write_file(const char* filename, const std::string& contents) {
+  std::ofstream file(filename, std::ios::binary);
+  file.write(contents.data(), contents.size());
+}
+
+TEST_CASE("mapped_file") {
+  const char* filename = "mapped_file_test.tmp";
+
+  SECTION("contents") {
+    write_file(filename, "cls\nret\n");
+    mapped_file file(filename);
+    REQUIRE(file.is_open());
+    REQUIRE(file.view() == "cls\nret\n");
+
+    mapped_file moved(std::move(file));
+    REQUIRE(!file.is_open());
+    REQUIRE(file.size() == 0);
+    REQUIRE(moved.view() == "cls\nret\n");
+  }
+
+  SECTION("empty file") {
+    write_file(filename, "");
+    mapped_file file(filename);
+    REQUIRE(file.is_open());
+    REQUIRE(file.view().empty());
+  }
+
+  SECTION("missing file") {
+    std::remove(filename);
+    mapped_file file(filename);
+    REQUIRE(!file.is_open());
+    REQUIRE(file.view().empty());
+  }
+
+  std::remove(filename);
+}
@@ -0,0 +1,89 @@
+#include "common/spsc_queue.hpp"
+#include <catch.hpp>
+#include <memory>
+#include <thread>
+
+namespace {
+int live = 0;
+
+struct tracked {
+  tracked() {
+    ++live;
+  }
+  ~tracked() {
+    --live;
+  }
+};
+}
+
+TEST_CASE("spsc_queue") {
+  SECTION("single thread") {
+    spsc_queue<int, 4> q;
+    int value = 0;
+    REQUIRE(!q.pop(value));
+    REQUIRE(q.push(1));
+    REQUIRE(q.push(2));
+    REQUIRE(q.push(3));
+    REQUIRE(q.push(4));
+    REQUIRE(!q.push(5));
+    REQUIRE(q.pop(value));
+    REQUIRE(value == 1);
+    REQUIRE(q.push(5));
+    for (int expected = 2; expected <= 5; ++expected) {
+      REQUIRE(q.pop(value));
+      REQUIRE(value == expected);
+    }
+    REQUIRE(!q.pop(value));
+  }
+
+  SECTION("owning items") {
+    {
+      spsc_queue<std::unique_ptr<tracked>, 2> q;
+      REQUIRE(q.push(std::make_unique<tracked>()));
+      REQUIRE(q.push(std::make_unique<tracked>()));
+
+      // a rejected push leaves ownership with the caller
+      auto rejected = std::make_unique<tracked>();
+      REQUIRE(!q.push(std::move(rejected)));
+      REQUIRE(rejected != nullptr);
+      rejected.reset();
+      REQUIRE(live == 2);
+
+      // popping hands the item over without leaving a copy behind
+      std::unique_ptr<tracked> value;
+      REQUIRE(q.pop(value));
+      value.reset();
+      REQUIRE(live == 1);
+
+      // the item left in the queue is released with it
+    }
+    REQUIRE(live == 0);
+  }
+
+  SECTION("two threads") {
+    constexpr int COUNT = 100000;
+    spsc_queue<int, 64> q;
+
+    std::thread producer([&]() {
+      for (int i = 0; i < COUNT; ++i) {
+        while (!q.push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    bool in_order = true;
+    for (int expected = 0; expected < COUNT;) {
+      int value;
+      if (q.pop(value)) {
+        in_order = in_order && value == expected;
+        ++expected;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    producer.join();
+
+    REQUIRE(in_order);
+  }
+}
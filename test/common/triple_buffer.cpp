@@ -0,0 +1,53 @@
+#include "common/triple_buffer.hpp"
+#include <catch.hpp>
+#include <atomic>
+#include <thread>
+
+TEST_CASE("triple_buffer") {
+  SECTION("single thread") {
+    triple_buffer<int> b;
+    REQUIRE(!b.update());
+    b.back() = 1;
+    b.publish();
+    b.back() = 2;
+    b.publish();
+    REQUIRE(b.update());
+    REQUIRE(b.front() == 2);
+    REQUIRE(!b.update());
+    REQUIRE(b.front() == 2);
+  }
+
+  SECTION("two threads") {
+    constexpr int COUNT = 100000;
+    triple_buffer<int> b;
+    std::atomic<bool> done = false;
+
+    std::thread writer([&]() {
+      for (int i = 1; i <= COUNT; ++i) {
+        b.back() = i;
+        b.publish();
+      }
+      done = true;
+    });
+
+    bool monotonic = true;
+    int last = 0;
+    for (;;) {
+      const bool finished = done;
+      if (b.update()) {
+        monotonic = monotonic && b.front() > last;
+        last = b.front();
+      }
+      if (finished && !b.update()) {
+        break;
+      }
+    }
+    writer.join();
+    if (b.update()) {
+      last = b.front();
+    }
+
+    REQUIRE(monotonic);
+    REQUIRE(last == COUNT);
+  }
+}
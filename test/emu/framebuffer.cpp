@@ -0,0 +1,65 @@
+#include <catch.hpp>
+#include "emu/framebuffer.hpp"
+
+TEST_CASE("framebuffer change tracking") {
+  framebuffer fb{64, 32};
+  const uint64_t start = fb.generation();
+
+  SECTION("nothing changed") {
+    REQUIRE(fb.changed_since(start).empty());
+  }
+
+  SECTION("toggle marks its row") {
+    fb.toggle(3, 5);
+    fb.toggle(60, 9);
+    REQUIRE(fb.generation() > start);
+    const auto span = fb.changed_since(start);
+    REQUIRE(span.first == 5);
+    REQUIRE(span.last == 10);
+
+    const uint64_t seen = fb.generation();
+    fb.toggle(0, 31 + 32);
+    const auto wrapped = fb.changed_since(seen);
+    REQUIRE(wrapped.first == 31);
+    REQUIRE(wrapped.last == 32);
+  }
+
+  SECTION("clear marks every row") {
+    fb.clear();
+    const auto span = fb.changed_since(start);
+    REQUIRE(span.first == 0);
+    REQUIRE(span.last == 32);
+  }
+
+  SECTION("resize keeps counting") {
+    fb.toggle(1, 1);
+    const uint64_t before = fb.generation();
+    fb.resize(128, 64);
+    REQUIRE(fb.generation() > before);
+    REQUIRE(fb.changed_since(before).last == 64);
+    REQUIRE(!fb.is_on(1, 1));
+  }
+
+  SECTION("touch_all passes the given generation") {
+    fb.touch_all(1000);
+    REQUIRE(fb.generation() > 1000);
+    REQUIRE(fb.changed_since(1000).last == 32);
+  }
+}
+
+TEST_CASE("framebuffer packing") {
+  framebuffer fb{64, 32};
+  REQUIRE(fb.stride() == 8);
+
+  REQUIRE(fb.toggle(0, 0));
+  REQUIRE(fb.toggle(9, 1));
+  REQUIRE(fb.toggle(63, 31));
+  REQUIRE(fb.data()[0] == 0x80);
+  REQUIRE(fb.data()[8 + 1] == 0x40);
+  REQUIRE(fb.data()[31 * 8 + 7] == 0x01);
+  REQUIRE(fb.is_on(9, 1));
+  REQUIRE(!fb.is_on(8, 1));
+
+  REQUIRE(!fb.toggle(9, 1));
+  REQUIRE(fb.data()[8 + 1] == 0);
+}
@@ -0,0 +1,93 @@
+#include <catch.hpp>
+#include <cstring>
+#include <memory>
+#include "asm/compiler.hpp"
+#include "emu/tuner.hpp"
+#include "emu/vm.hpp"
+
+std::unique_ptr<chip8vm> load_program(const char* source) {
+  auto vm = std::make_unique<chip8vm>();
+  auto program = compile(source);
+  std::memcpy(&vm->memory[chip8vm::PROGRAM_START], program.data(), program.size());
+  return vm;
+}
+
+void run_frames(chip8vm& vm, cycle_tuner& tuner, int cycles_per_frame) {
+  while (!tuner.finished()) {
+    for (int i = 0; i < cycles_per_frame; ++i) {
+      tuner.observe(vm);
+      vm.step();
+    }
+    vm.dec_timers();
+    tuner.end_frame();
+  }
+}
+
+TEST_CASE("cycle_tuner") {
+  cycle_tuner tuner(10);
+
+  SECTION("waits on dt") {
+    auto vm = load_program(R"(
+      loop:
+        add v1, 1
+        add v1, 1
+        add v1, 1
+        add v1, 1
+        ld  v0, 1
+        ld  dt, v0
+      wait:
+        ld   v0, dt
+        skeq v0, 0
+        jmp  wait
+        jmp  loop
+    )");
+    run_frames(*vm, tuner, 1000);
+    auto rec = tuner.recommendation();
+    REQUIRE(rec);
+    // one pass through the loop plus the first dt read is the useful part of each frame
+    REQUIRE(*rec >= 10);
+    REQUIRE(*rec < 100);
+  }
+
+  SECTION("spins on a jump to itself") {
+    auto vm = load_program(R"(
+        ld v0, 1
+        ld v1, 2
+      halt:
+        jmp halt
+    )");
+    run_frames(*vm, tuner, 1000);
+    auto rec = tuner.recommendation();
+    REQUIRE(rec);
+    REQUIRE(*rec < 10);
+  }
+
+  SECTION("ends frames on a display wait") {
+    auto vm = load_program(R"(
+      loop:
+        add v1, 1
+        add v1, 1
+        disp v0, v0, 1
+        jmp loop
+    )");
+    vm->cflags = compat_flags::display_wait;
+    while (!tuner.finished()) {
+      vm->run(1000, [&](const chip8vm& state) { tuner.observe(state); });
+      REQUIRE(vm->waiting_for_vblank());
+      tuner.end_frame(vm->waiting_for_vblank());
+    }
+    auto rec = tuner.recommendation();
+    REQUIRE(rec);
+    REQUIRE(*rec < 10);
+  }
+
+  SECTION("never idles") {
+    auto vm = load_program(R"(
+      loop:
+        add v1, 1
+        jmp loop
+    )");
+    run_frames(*vm, tuner, 1000);
+    REQUIRE(!tuner.recommendation());
+  }
+}
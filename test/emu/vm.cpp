@@ -377,3 +377,74 @@ TEST_CASE("single instructions") {
     }
   }
 }
+
+TEST_CASE("run") {
+  auto p = std::make_unique<chip8vm>();
+  uint16_t* write = reinterpret_cast<uint16_t*>(p->memory.data() + chip8vm::PROGRAM_START);
+  for (uint16_t opcode : {0x7001, 0xD005, 0x7001, 0x1200})
+    *write++ = eswap(opcode);
+
+  SECTION("executes the requested number of instructions") {
+    REQUIRE(p->run(10) == 10);
+    REQUIRE(p->status == cpu_status::ok);
+    REQUIRE(p->variables[0] == 5);
+  }
+
+  SECTION("stops when the cpu faults") {
+    p->memory[0x206] = 0xFF;
+    p->memory[0x207] = 0xFF;
+    REQUIRE(p->run(10) == 4);
+    REQUIRE(p->status == cpu_status::invalid_instruction);
+  }
+
+  SECTION("display wait ends the frame after drawing") {
+    p->cflags = compat_flags::display_wait;
+    REQUIRE(p->run(10) == 2);
+    REQUIRE(p->pc == 0x204);
+    REQUIRE(p->run(10) == 4);
+    REQUIRE(p->pc == 0x204);
+  }
+}
+
+TEST_CASE("run with input") {
+  auto p = std::make_unique<chip8vm>();
+  uint16_t* write = reinterpret_cast<uint16_t*>(p->memory.data() + chip8vm::PROGRAM_START);
+  // counts loop iterations in v0 until key 5 is pressed
+  // skp v1; add v0, 1; jmp 0x200
+  for (uint16_t opcode : {0xE19E, 0x7001, 0x1200})
+    *write++ = eswap(opcode);
+  p->variables[1] = 5;
+
+  const auto nothing = [](const chip8vm&) {};
+
+  SECTION("events apply at their cycle") {
+    const input_event events[] = {{30, HEXKEY_5, true}};
+    REQUIRE(p->run(90, std::begin(events), std::end(events), nothing) == 90);
+    REQUIRE(p->variables[0] == 10);
+    REQUIRE(p->inp.is_pressed(HEXKEY_5));
+  }
+
+  SECTION("events past the end of the frame apply after it") {
+    const input_event events[] = {{30, HEXKEY_5, true}, {31, HEXKEY_5, false}};
+    REQUIRE(p->run(15, std::begin(events), std::end(events), nothing) == 15);
+    REQUIRE(p->variables[0] == 5);
+    REQUIRE(!p->inp.is_pressed(HEXKEY_5));
+    REQUIRE(p->inp.last_key == HEXKEY_5);
+  }
+}
+
+TEST_CASE("copy") {
+  auto p = std::make_unique<chip8vm>();
+  uint16_t* write = reinterpret_cast<uint16_t*>(p->memory.data() + chip8vm::PROGRAM_START);
+  // rand v0, 0xff; add v1, v0; jmp 0x200
+  for (uint16_t opcode : {0xC0FF, 0x8104, 0x1200})
+    *write++ = eswap(opcode);
+
+  p->run(30);
+  auto q = std::make_unique<chip8vm>(*p);
+  p->run(300);
+  q->run(300);
+
+  REQUIRE(p->pc == q->pc);
+  REQUIRE(p->variables == q->variables);
+}